@@ -1,7 +1,13 @@
 #include "BoundingRectangularPrism.h"
 
 #include "Particle.h"
+#include "Async/Async.h"
+#include "Components/StaticMeshComponent.h"
+#include "CoreGlobals.h"
+#include "Engine/StaticMesh.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/Paths.h"
+#include "StaticMeshResources.h"
 
 // Sets default values
 ABoundingRectangularPrism::ABoundingRectangularPrism()
@@ -21,9 +27,50 @@ ABoundingRectangularPrism::ABoundingRectangularPrism()
 	SmoothingRadius = 25.0f; // Default smoothing radius for SPH
 	PressureFactor = 500.0f; // Default pressure factor for SPH
 	Restitution = 0.8f;
+    PressureSolver = EFluidPressureSolver::EquationOfState;
+    PressureTolerance = 0.01f;
+    MaxPressureIterations = 50;
+    PressureRelaxation = 0.5f;
+    PressureIterations = 0;
+    PressureDensityError = 0.0f;
+    ArtificialViscosity = 0.0f;
+    XSPHFactor = 0.0f;
+    SurfaceTension = 0.0f;
+    bProfileForceModules = false;
     MinSpeedForColor = 0.0f;
     MaxSpeedForColor = 2.0f;
     bDrawBoundingBox = true;
+    bCompactNeighborState = false;
+    bAsyncSimulation = false;
+    AsyncLatencyFrames = 0;
+    AsyncLatencyMs = 0.0f;
+    AsyncStepMs = 0.0f;
+    AsyncGameThreadWaitMs = 0.0f;
+    NumDomainRanks = 1;
+    DomainTransport = EFluidHaloTransportType::InProcess;
+    ColliderCellSize = 5.0f;
+    bRenderSurface = false;
+    SurfaceCellSize = 8.0f;
+    SurfaceIsoLevel = 0.3f;
+    SurfaceRemeshTolerance = 2.0f;
+    SurfaceMeshMs = 0.0f;
+    SurfaceUploadMs = 0.0f;
+    SurfaceTriangles = 0;
+    SurfaceDirtyBlocks = 0;
+
+    // Explicit root so the actor has a transform of its own and the surface component is never promoted to root
+    RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+    // The surface is meshed in world space, so the component stays at the world origin wherever the prism is
+    SurfaceMeshComponent = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("SurfaceMesh"));
+    SurfaceMeshComponent->SetupAttachment(RootComponent);
+    SurfaceMeshComponent->SetUsingAbsoluteLocation(true);
+    SurfaceMeshComponent->SetUsingAbsoluteRotation(true);
+    SurfaceMeshComponent->SetUsingAbsoluteScale(true);
+    SurfaceMeshComponent->bUseAsyncCooking = true;
+
+    // Viscosity, XSPH and cohesion run inside the pressure neighbor loop once their strength is above zero
+    RegisterDefaultFluidForceModules(Solver);
 
      ConstructorHelpers::FClassFinder<AParticle> ParticleBPClass(TEXT("/Game/Blueprints/BP_Particle"));
      if (ParticleBPClass.Class != nullptr)
@@ -41,11 +88,28 @@ void ABoundingRectangularPrism::BeginPlay()
 {
 	Super::BeginPlay();
 
+    ValidateSolverSettings();
+
+    // A bake can take seconds, so it runs in the background; particles ignore the obstacles until it is done and are
+    // then pushed out of them, however deep they went
+    BakeColliders();
+
 	// Clear any existing particles before spawning new ones
 	DestroyAllParticles();
     SpawnParticles();
 }
 
+void ABoundingRectangularPrism::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    // Stop the simulation thread before the particles it feeds go away
+    AsyncSimulation.Reset();
+
+    // A bake still in flight only owns copies of the triangles; its result is simply dropped
+    ColliderBake.Reset();
+
+    Super::EndPlay(EndPlayReason);
+}
+
 void ABoundingRectangularPrism::OnConstruction(const FTransform &Transform)
 { 
     Super::OnConstruction(Transform);
@@ -78,6 +142,20 @@ void ABoundingRectangularPrism::PostEditChangeProperty(FPropertyChangedEvent &Pr
         SpawnParticles();
 		ResolveBoundingBoxCollisions(0.0f); // Update particles immediately after spawning
     }
+    else if (PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, NumDomainRanks) ||
+        PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, DomainTransport))
+    {
+        // Ranks are rebuilt from the current solver state on the next tick
+        DomainDecomposition.Reset();
+    }
+
+    if (PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, PressureSolver) ||
+        PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, NumDomainRanks) ||
+        PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, ParticleGridSpacing) ||
+        PropertyName == GET_MEMBER_NAME_CHECKED(ABoundingRectangularPrism, SmoothingRadius))
+    {
+        ValidateSolverSettings();
+    }
 }
 #endif
 
@@ -90,42 +168,84 @@ void ABoundingRectangularPrism::Tick(float DeltaTime)
 	// Draw the bounding box every frame, it will clear out otherwise
     DrawBoundingRectangularPrism();
 
-    ParallelFor(ManagedParticles.Num(), [&](int32 Index)
-        {
-            AParticle *Particle = ManagedParticles[Index];
-            // Apply gravity to the particle's velocity
-            Particle->Velocity += FVector::DownVector * Gravity * DeltaTime;
-
-			// TODO look into implementing predicted positions for increased time to get to system stability
-        });
-
-    // Pre-calculate densities around each particle; they will be used by pressure calculations
-    ParallelFor(ManagedParticles.Num(), [&](int32 Index)
-        {
-			AParticle *Particle = ManagedParticles[Index];
+    if (ColliderBake.IsValid() && ColliderBake.IsReady())
+    {
+        ColliderField = ColliderBake.Get();
+        ColliderBake.Reset();
+    }
 
-            DensitiesAroundParticle[Index] = CalculateDensity(Particle->Position);
-        });
+    // Pick up any property changes made since the last frame
+    Solver.Params = MakeSolverParams();
 
+    if (bAsyncSimulation)
+    {
+        DomainDecomposition.Reset();
+        StepAsyncSimulation(DeltaTime);
+    }
+    else if (NumDomainRanks > 1 && PressureSolver == EFluidPressureSolver::EquationOfState)
+    {
+        AsyncSimulation.Reset();
+        StepDomainDecomposition(DeltaTime);
+    }
+    else
+    {
+        AsyncSimulation.Reset();
+        DomainDecomposition.Reset();
+        Solver.Step(DeltaTime); // Gravity, densities, pressure forces, then integration and bounding box collisions
+    }
 
-	// Apply gravity to the particle's velocity, alculate pressure forces and apply them to the particles' velocities
-    ParallelFor(ManagedParticles.Num(), [&](int32 Index)
-        {
-            AParticle *Particle = ManagedParticles[Index];
+    // The async path reports the convergence of the step it just displayed; decomposition only runs with the equation
+    // of state, so there is nothing to report on that path
+    FFluidPressureSolveStats PressureStats = Solver.PressureStats;
+    if (AsyncSimulation.IsValid())
+    {
+        PressureStats = AsyncSimulation->GetStats().PressureStats;
+    }
+    else if (DomainDecomposition.IsValid())
+    {
+        PressureStats = FFluidPressureSolveStats();
+    }
+    PressureIterations = PressureStats.Iterations;
+    PressureDensityError = PressureStats.DensityError;
 
-			// Calculate pressure force based on the density of the particle and its neighbors
-			FVector PressureForce = CalculatePressureForce(Index);
+    if (PressureSolver == EFluidPressureSolver::Implicit && !DomainDecomposition.IsValid())
+    {
+        UE_LOG(LogTemp, Verbose, TEXT("ABoundingRectangularPrism: implicit pressure converged in %d iterations, density error %.3f%%."), PressureIterations, PressureDensityError * 100.0f);
+    }
 
-			// F = m * a; but instead of mass, we use the density
-			FVector PressureAcceleration = PressureForce / DensitiesAroundParticle[Index];
+    // Force module timings come from whichever path stepped this frame
+    TArray<FFluidForceModuleStats> ModuleStats = Solver.ForceModuleStats;
+    if (AsyncSimulation.IsValid())
+    {
+        ModuleStats = AsyncSimulation->GetStats().ForceModuleStats;
+    }
+    else if (DomainDecomposition.IsValid())
+    {
+        ModuleStats = DomainDecomposition->GetForceModuleStats();
+    }
 
-			// Update the particle's velocity based on the pressure acceleration
-			Particle->Velocity += PressureAcceleration * DeltaTime;
-        });
+    ForceModuleMs.Reset();
+    for (const FFluidForceModuleStats &Module : ModuleStats)
+    {
+        ForceModuleMs.Add(Module.Name, Module.Ms);
+    }
 
-	// Also loops over particles to update their positions and handle collisions
-    // TODO: use parallel for here too?
-    ResolveBoundingBoxCollisions(DeltaTime);
+    // The surface replaces the per-particle spheres, so those are hidden rather than moved while it is shown
+    SetParticleActorsHidden(bRenderSurface);
+    if (bRenderSurface)
+    {
+        UpdateSurfaceMesh();
+    }
+    else
+    {
+        if (SurfaceMeshComponent->GetNumSections() > 0)
+        {
+            SurfaceMeshComponent->ClearAllMeshSections();
+            SurfaceMesher.Reset();
+            SurfaceSection.Reset();
+        }
+        UpdateParticleActors();
+    }
 
     // Update color based on speed; still needs debugging and makes the simulation run slow
     //for (int32 Index = 0; Index < ManagedParticles.Num(); ++Index)
@@ -134,6 +254,7 @@ void ABoundingRectangularPrism::Tick(float DeltaTime)
     //    Particle->UpdateColorBasedOnSpeed(MinSpeedForColor, MaxSpeedForColor);
     //};
 }
+
 void ABoundingRectangularPrism::DrawBoundingRectangularPrism()
 {
     // Draw the debug bounding box if enabled
@@ -160,140 +281,126 @@ void ABoundingRectangularPrism::SpawnParticles()
         return;
     }
 
-    float TotalSpanPerAxis = (ParticleCountPerAxis > 1) ? (ParticleCountPerAxis - 1.0f) * ParticleGridSpacing : 0.0f;
-    FVector HalfSpan = FVector(TotalSpanPerAxis, TotalSpanPerAxis, TotalSpanPerAxis) / 2.0f;
     FRandomStream RandomStream;
     RandomStream.Initialize(FMath::Rand());
 
     ManagedParticles.Empty();
+    AsyncSimulation.Reset();
+    DomainDecomposition.Reset();
+
+    // The solver lays out the jittered grid; every solver particle then gets an actor for rendering
+    Solver.Reset();
+    Solver.Params = MakeSolverParams();
+    Solver.SpawnParticleBlock(GetActorLocation(), FIntVector(ParticleCountPerAxis), ParticleGridSpacing, JitterFactor, RandomStream);
 
-    for (int x = 0; x < ParticleCountPerAxis; x++)
+    for (int32 Index = 0; Index < Solver.NumOwned; ++Index)
     {
-        for (int y = 0; y < ParticleCountPerAxis; y++)
+        FVector DesiredParticleWorldLocation = Solver.Positions[Index];
+
+        FActorSpawnParameters SpawnParams;
+        SpawnParams.Owner = this;
+        SpawnParams.Instigator = GetInstigator();
+
+        AParticle *NewParticle = GetWorld()->SpawnActor<AParticle>(ParticleClass, DesiredParticleWorldLocation, FRotator::ZeroRotator, SpawnParams);
+
+        if (NewParticle)
         {
-            for (int z = 0; z < ParticleCountPerAxis; z++)
-            {
-                FVector RelativeGridPos;
-                if (ParticleCountPerAxis > 1)
-                {
-                    RelativeGridPos.X = (float)x * ParticleGridSpacing;
-                    RelativeGridPos.Y = (float)y * ParticleGridSpacing;
-                    RelativeGridPos.Z = (float)z * ParticleGridSpacing;
-                }
-                else
-                {
-                    RelativeGridPos = FVector::ZeroVector;
-                }
-
-                FVector DesiredParticleWorldLocation = GetActorLocation() + (RelativeGridPos - HalfSpan);
-
-                if (JitterFactor > KINDA_SMALL_NUMBER)
-                {
-                    DesiredParticleWorldLocation.X += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
-                    DesiredParticleWorldLocation.Y += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
-                    DesiredParticleWorldLocation.Z += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
-                }
-
-                FActorSpawnParameters SpawnParams;
-                SpawnParams.Owner = this;
-                SpawnParams.Instigator = GetInstigator();
-
-                AParticle *NewParticle = GetWorld()->SpawnActor<AParticle>(ParticleClass, DesiredParticleWorldLocation, FRotator::ZeroRotator, SpawnParams);
-
-                if (NewParticle)
-                {
-                    NewParticle->Radius = ParticleRadius;
-                    NewParticle->Position = DesiredParticleWorldLocation;
-                    NewParticle->Velocity = FVector::ZeroVector;
-                    NewParticle->GenerateSphereMesh();
-                    NewParticle->SetActorLocation(NewParticle->Position);
-
-                    ManagedParticles.Add(NewParticle);
-					DensitiesAroundParticle.Add(0.0f); // Initialize density for this particle
+            NewParticle->Radius = ParticleRadius;
+            NewParticle->Position = DesiredParticleWorldLocation;
+            NewParticle->Velocity = FVector::ZeroVector;
+            NewParticle->GenerateSphereMesh();
+            NewParticle->SetActorLocation(NewParticle->Position);
 #if 0
-                    UE_LOG(LogTemp, Log, TEXT("ABoundingRectangularPrism: Spawned Particle %s at World Pos: %s, Stored Pos: %s"),
-                        *NewParticle->GetName(), *NewParticle->GetActorLocation().ToString(), *NewParticle->Position.ToString());
+            UE_LOG(LogTemp, Log, TEXT("ABoundingRectangularPrism: Spawned Particle %s at World Pos: %s, Stored Pos: %s"),
+                *NewParticle->GetName(), *NewParticle->GetActorLocation().ToString(), *NewParticle->Position.ToString());
 #endif
-                }
-                else
-                {
-                    UE_LOG(LogTemp, Error, TEXT("ABoundingRectangularPrism: Failed to spawn particle at location: %s"), *DesiredParticleWorldLocation.ToString());
-                }
-            }
         }
+        else
+        {
+            UE_LOG(LogTemp, Error, TEXT("ABoundingRectangularPrism: Failed to spawn particle at location: %s"), *DesiredParticleWorldLocation.ToString());
+        }
+
+        // Keep the slot even if spawning failed so actor indices stay aligned with solver indices
+        ManagedParticles.Add(NewParticle);
     }
 
     UE_LOG(LogTemp, Log, TEXT("ABoundingRectangularPrism: Spawned %d particles."), ManagedParticles.Num());
 }
 
-void ABoundingRectangularPrism::ResolveBoundingBoxCollisions(float DeltaTime)
+void ABoundingRectangularPrism::BakeColliders()
 {
-    FVector MinBounds = GetActorLocation() - BoxExtent;
-    FVector MaxBounds = GetActorLocation() + BoxExtent;
+    ColliderField.Reset();
+    ColliderBake.Reset();
 
-    for (int32 Index = 0; Index < ManagedParticles.Num(); ++Index)
+    // Gather LOD0 (on the game thread, where the components may be read) of every static mesh on the collider actors as one world-space triangle list
+    TArray<FVector> Vertices;
+    TArray<int32> Indices;
+    for (AActor *ColliderActor : ColliderActors)
     {
-        AParticle* Particle = ManagedParticles[Index];
-
-        // Store the particle's previous position for comparison
-        FVector PreviousPosition = Particle->Position;
-
-        // Update particle's position (which is now its WORLD position)
-        Particle->Position += Particle->Velocity * DeltaTime;
-
-        // Perform Bounding Box Collision
-        bool bPositionOrVelocityChanged = false; 
-
-        // Check X-axis collision
-        if (Particle->Position.X - Particle->Radius < MinBounds.X)
-        {
-            Particle->Position.X = MinBounds.X + Particle->Radius;
-            Particle->Velocity.X *= -Restitution;
-            bPositionOrVelocityChanged = true;
-        }
-        else if (Particle->Position.X + Particle->Radius > MaxBounds.X)
+        if (ColliderActor == nullptr)
         {
-            Particle->Position.X = MaxBounds.X - Particle->Radius;
-            Particle->Velocity.X *= -Restitution;
-            bPositionOrVelocityChanged = true;
+            continue;
         }
 
-        // Check Y-axis collision
-        if (Particle->Position.Y - Particle->Radius < MinBounds.Y)
+        TArray<UStaticMeshComponent *> MeshComponents;
+        ColliderActor->GetComponents<UStaticMeshComponent>(MeshComponents);
+        for (UStaticMeshComponent *MeshComponent : MeshComponents)
         {
-            Particle->Position.Y = MinBounds.Y + Particle->Radius;
-            Particle->Velocity.Y *= -Restitution;
-            bPositionOrVelocityChanged = true;
-        }
-        else if (Particle->Position.Y + Particle->Radius > MaxBounds.Y)
-        {
-            Particle->Position.Y = MaxBounds.Y - Particle->Radius;
-            Particle->Velocity.Y *= -Restitution;
-            bPositionOrVelocityChanged = true;
-        }
+            UStaticMesh *Mesh = MeshComponent->GetStaticMesh();
+            if (Mesh == nullptr || Mesh->GetRenderData() == nullptr || Mesh->GetRenderData()->LODResources.Num() == 0)
+            {
+                continue;
+            }
+            if (FPlatformProperties::RequiresCookedData() && !Mesh->bAllowCPUAccess)
+            {
+                UE_LOG(LogTemp, Warning, TEXT("ABoundingRectangularPrism: %s needs Allow CPU Access to be used as a collider."), *Mesh->GetName());
+                continue;
+            }
 
-        // Check Z-axis collision (floor and ceiling)
-        if (Particle->Position.Z - Particle->Radius < MinBounds.Z)
-        {
-            Particle->Position.Z = MinBounds.Z + Particle->Radius;
-            Particle->Velocity.Z *= -Restitution;
-            Particle->Velocity.X *= 0.9f;
-            Particle->Velocity.Y *= 0.9f;
-            bPositionOrVelocityChanged = true;
-        }
-        else if (Particle->Position.Z + Particle->Radius > MaxBounds.Z)
-        {
-            Particle->Position.Z = MaxBounds.Z - Particle->Radius;
-            Particle->Velocity.Z *= -Restitution;
-            bPositionOrVelocityChanged = true;
-        }
+            const FStaticMeshLODResources &LOD = Mesh->GetRenderData()->LODResources[0];
+            const FTransform Transform = MeshComponent->GetComponentTransform();
+            const int32 BaseVertex = Vertices.Num();
+            for (uint32 VertexIndex = 0; VertexIndex < LOD.VertexBuffers.PositionVertexBuffer.GetNumVertices(); ++VertexIndex)
+            {
+                Vertices.Add(Transform.TransformPosition(FVector(LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(VertexIndex))));
+            }
 
-        // Only update if necessary
-        if (bPositionOrVelocityChanged || !Particle->Velocity.IsZero() || !PreviousPosition.Equals(Particle->Position, KINDA_SMALL_NUMBER))
-        {
-            Particle->SetActorLocation(Particle->Position);
+            // Mirroring scales flip the winding, which would flip the sign of the baked distances
+            const bool bFlipWinding = Transform.GetDeterminant() < 0.0f;
+            TArray<uint32> MeshIndices;
+            LOD.IndexBuffer.GetCopy(MeshIndices);
+            for (int32 Index = 0; Index + 2 < MeshIndices.Num(); Index += 3)
+            {
+                Indices.Add(BaseVertex + MeshIndices[Index]);
+                Indices.Add(BaseVertex + MeshIndices[Index + (bFlipWinding ? 2 : 1)]);
+                Indices.Add(BaseVertex + MeshIndices[Index + (bFlipWinding ? 1 : 2)]);
+            }
         }
     }
+
+    if (Indices.Num() == 0)
+    {
+        return;
+    }
+
+    // The band only has to reach past the particle radius; everything further away is stored as one value per brick
+    float BandWidth = ParticleRadius + 2.0f * ColliderCellSize;
+    float CellSize = ColliderCellSize;
+    FString CacheDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("FluidSDF"));
+    ColliderBake = Async(EAsyncExecution::ThreadPool, [Vertices = MoveTemp(Vertices), Indices = MoveTemp(Indices), CellSize, BandWidth, CacheDirectory]()
+        {
+            return FFluidSignedDistanceField::LoadOrBake(Vertices, Indices, CellSize, BandWidth, CacheDirectory);
+        });
+}
+
+void ABoundingRectangularPrism::ResolveBoundingBoxCollisions(float DeltaTime)
+{
+    // The simulation thread owns the particle state while it runs
+    AsyncSimulation.Reset();
+
+    Solver.Params = MakeSolverParams();
+    Solver.ResolveBoundingBoxCollisions(DeltaTime);
+    UpdateParticleActors();
 }
 
 void ABoundingRectangularPrism::DestroyAllParticles()
@@ -311,83 +418,145 @@ void ABoundingRectangularPrism::DestroyAllParticles()
     }
 
     ManagedParticles.Empty(); // Clear the array of particles
+    AsyncSimulation.Reset();
+    Solver.Reset();
+    DomainDecomposition.Reset();
 }
 
-float SmoothingKernel(float Distance, float Radius)
+FFluidSolverParams ABoundingRectangularPrism::MakeSolverParams() const
 {
-	if (Distance >= Radius)
-	{
-		return 0.0f; // Outside the influence radius
-	}
-
-	float Volume = PI * pow(Radius, 4) / 6.0f;
-
-    return (Radius - Distance) * (Radius - Distance) / Volume;
+    FFluidSolverParams Params;
+    Params.BoxCenter = GetActorLocation();
+    Params.BoxExtent = BoxExtent;
+    Params.Gravity = Gravity;
+    Params.ParticleRadius = ParticleRadius;
+    Params.ParticleMass = ParticleMass;
+    Params.TargetDensity = TargetDensity;
+    Params.PressureFactor = PressureFactor;
+    Params.SmoothingRadius = SmoothingRadius;
+    Params.Restitution = Restitution;
+    Params.bCompactNeighborState = bCompactNeighborState;
+    Params.PressureSolver = PressureSolver;
+    Params.ParticleSpacing = ParticleGridSpacing; // The spawn lattice is the rest state of the implicit solver
+    Params.PressureTolerance = PressureTolerance;
+    Params.MaxPressureIterations = MaxPressureIterations;
+    Params.PressureRelaxation = PressureRelaxation;
+    Params.ArtificialViscosity = ArtificialViscosity;
+    Params.XSPHFactor = XSPHFactor;
+    Params.SurfaceTension = SurfaceTension;
+    Params.bProfileForceModules = bProfileForceModules;
+    Params.SignedDistanceField = ColliderField;
+    return Params;
 }
 
-float SmoothingKernelDerivative(float Distance, float Radius)
+void ABoundingRectangularPrism::ValidateSolverSettings() const
 {
-	if (Distance >= Radius)
-	{
-		return 0.0f; // Outside the influence radius
-	}
+    if (PressureSolver == EFluidPressureSolver::Implicit && ParticleGridSpacing >= SmoothingRadius)
+    {
+        FFluidSolver Probe;
+        Probe.Params = MakeSolverParams();
+        UE_LOG(LogTemp, Warning, TEXT("ABoundingRectangularPrism: ParticleGridSpacing %.1f is not below SmoothingRadius %.1f, so spawned particles do not see each other; the implicit solver uses a rest spacing of %.1f (rest density %g) instead."),
+            ParticleGridSpacing, SmoothingRadius, Probe.GetImplicitRestSpacing(), Probe.GetImplicitRestDensity());
+    }
 
-	float Scale = 12 / (PI * pow(Radius, 4));
-	return (Distance - Radius) * Scale;
+    if (PressureSolver == EFluidPressureSolver::Implicit && NumDomainRanks > 1 && !bAsyncSimulation)
+    {
+        UE_LOG(LogTemp, Error, TEXT("ABoundingRectangularPrism: the implicit pressure solver does not support domain decomposition; NumDomainRanks %d is ignored and the scene runs on one solver. Switch to the equation of state to decompose it."), NumDomainRanks);
+    }
 }
 
-float ABoundingRectangularPrism::CalculateDensity(const FVector &SamplePoint)
+void ABoundingRectangularPrism::StepDomainDecomposition(float DeltaTime)
 {
-    float Density = 0.0f;
-    const float Mass = 1.0f;
+    // Slabs narrower than the smoothing radius would need halos from more than the direct neighbours
+    int32 NumRanks = FMath::Min(NumDomainRanks, FFluidDomainDecomposition::GetMaxRanks(Solver.Params));
 
-    // TODO: optimize to only look at particles within smoothing radius
-    for (const AParticle *Particle : ManagedParticles)
+    if (!DomainDecomposition.IsValid() || DomainDecomposition->GetNumRanks() != NumRanks || DomainDecomposition->GetNumParticles() != Solver.NumOwned)
     {
-        float Distance = (Particle->Position - SamplePoint).Size();
-        float Influence = SmoothingKernel(Distance, SmoothingRadius);
-        Density += Mass * Influence;
+        DomainDecomposition = MakeUnique<FFluidDomainDecomposition>(NumRanks, DomainTransport);
+        DomainDecomposition->Initialize(Solver.Params, Solver.Positions, Solver.Velocities);
+        DomainDecomposition->SetForceModules(Solver.GetForceModules());
     }
-    return Density;
+
+    DomainDecomposition->SetParams(Solver.Params);
+    if (!DomainDecomposition->Step(DeltaTime))
+    {
+        // Particles of the failed step are partly migrated; keep the last gathered state and start over next tick
+        UE_LOG(LogTemp, Error, TEXT("ABoundingRectangularPrism: domain decomposition step failed, rebuilding the %d ranks."), NumRanks);
+        DomainDecomposition.Reset();
+        return;
+    }
+    DomainDecomposition->GatherParticles(Solver.Positions, Solver.Velocities);
 }
 
-float ABoundingRectangularPrism::DensityToPressure(float Density)
+void ABoundingRectangularPrism::StepAsyncSimulation(float DeltaTime)
 {
-	// Calculate pressure based on the difference from target density
-	// This equation is better applicable for gasses but we will use it for liquids as well
-    float DensityDifference = (TargetDensity - Density);
-	float Pressure = PressureFactor * DensityDifference;
-	return Pressure;
+    if (!AsyncSimulation.IsValid())
+    {
+        AsyncSimulation = MakeUnique<FFluidAsyncSimulation>(Solver);
+    }
+
+    AsyncSimulation->SetParams(Solver.Params);
+    AsyncSimulation->Tick(DeltaTime, GFrameCounter, Solver.Positions, Solver.Velocities);
+
+    const FFluidAsyncSimulationStats &Stats = AsyncSimulation->GetStats();
+    AsyncLatencyFrames = Stats.LatencyFrames;
+    AsyncLatencyMs = Stats.LatencyMs;
+    AsyncStepMs = Stats.StepMs;
+    AsyncGameThreadWaitMs = Stats.GameThreadWaitMs;
 }
 
-float ABoundingRectangularPrism::CalculateSharedPressure(float Density1, float Density2)
+void ABoundingRectangularPrism::UpdateParticleActors()
 {
-	// Calculate shared pressure between two particles based on their densities
-	float Pressure1 = DensityToPressure(Density1);
-	float Pressure2 = DensityToPressure(Density2);
-	return (Pressure1 + Pressure2) / 2.0f; // Average pressure
+    for (int32 Index = 0; Index < ManagedParticles.Num(); ++Index)
+    {
+        AParticle *Particle = ManagedParticles[Index];
+        if (Particle == nullptr)
+        {
+            continue;
+        }
+
+        // Store the particle's previous position for comparison
+        FVector PreviousPosition = Particle->Position;
+
+        Particle->Position = Solver.Positions[Index];
+        Particle->Velocity = Solver.Velocities[Index];
+
+        // Only update if necessary
+        if (!Particle->Velocity.IsZero() || !PreviousPosition.Equals(Particle->Position, KINDA_SMALL_NUMBER))
+        {
+            Particle->SetActorLocation(Particle->Position);
+        }
+    }
 }
 
-FVector ABoundingRectangularPrism::CalculatePressureForce(int ParticleIndex)
+void ABoundingRectangularPrism::UpdateSurfaceMesh()
 {
-    FVector PressureForce = FVector::ZeroVector;
-    for (int CurrentParticleIndex = 0; CurrentParticleIndex < ManagedParticles.Num(); ++CurrentParticleIndex)
+    SurfaceMesher.Params.CellSize = SurfaceCellSize;
+    SurfaceMesher.Params.KernelRadius = SmoothingRadius;
+    SurfaceMesher.Params.IsoLevel = SurfaceIsoLevel;
+    SurfaceMesher.Params.RemeshTolerance = SurfaceRemeshTolerance;
+
+    // The actor's solver never holds ghosts, so every position is an owned particle
+    SurfaceUploadMs = 0.0f;
+    if (SurfaceMesher.Update(MakeArrayView(Solver.Positions.GetData(), Solver.NumOwned)))
     {
-		if (CurrentParticleIndex == ParticleIndex)
-		{
-			continue; // Skip the particle itself
-		}
-        const AParticle *CurrentParticle = ManagedParticles[CurrentParticleIndex];
-
-		FVector OffsetBetweenParticles = (CurrentParticle->Position - ManagedParticles[ParticleIndex]->Position);
-		float Distance = OffsetBetweenParticles.Size();
-        FVector Direction = Distance == 0 ? FMath::VRand() : OffsetBetweenParticles / Distance;
-        float Slope = SmoothingKernelDerivative(Distance, SmoothingRadius);
-        float Density = DensitiesAroundParticle[CurrentParticleIndex];
-		float SharedPressure = CalculateSharedPressure(Density, DensitiesAroundParticle[ParticleIndex]);
-        PressureForce += SharedPressure * Slope *Direction *ParticleMass / Density;
+        SurfaceSection.Upload(*SurfaceMeshComponent, 0, SurfaceMesher);
+        SurfaceUploadMs = SurfaceSection.GetStats().Ms;
     }
-    return PressureForce;
-}
 
+    const FFluidSurfaceMesherStats &Stats = SurfaceMesher.GetStats();
+    SurfaceMeshMs = Stats.Ms;
+    SurfaceTriangles = Stats.NumTriangles;
+    SurfaceDirtyBlocks = Stats.NumDirtyBlocks;
+}
 
+void ABoundingRectangularPrism::SetParticleActorsHidden(bool bHidden)
+{
+    for (AParticle *Particle : ManagedParticles)
+    {
+        if (Particle && Particle->IsHidden() != bHidden)
+        {
+            Particle->SetActorHiddenInGame(bHidden);
+        }
+    }
+}
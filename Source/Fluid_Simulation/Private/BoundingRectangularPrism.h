@@ -1,8 +1,17 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "GameFramework/Actor.h"
 #include "DrawDebugHelpers.h" // Required for DrawDebugBox
+#include "FluidAsyncSimulation.h"
+#include "FluidDomainDecomposition.h"
+#include "FluidForceModules.h"
+#include "FluidHaloTransport.h"
+#include "FluidSolver.h"
+#include "FluidSurfaceMesher.h"
+#include "FluidSurfaceSection.h"
+#include "ProceduralMeshComponent.h"
 #include "BoundingRectangularPrism.generated.h"
 
 // Forward declaration of the AParticle class
@@ -21,6 +30,9 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called when an instance of this class is placed (in editor) or spawned.
 	virtual void OnConstruction(const FTransform &Transform) override;
 
@@ -65,6 +77,7 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fluid Simulation")
 	float ParticleMass;
 
+	// Equation of state only; the implicit solver's rest density follows from ParticleMass, ParticleGridSpacing and SmoothingRadius
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fluid Simulation")
 	float TargetDensity;
 
@@ -74,34 +87,172 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Fluid Simulation")
 	float SmoothingRadius;
 
+	// How pressure is derived from density; the implicit solver stays stable at much larger time steps
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pressure Solver")
+	EFluidPressureSolver PressureSolver;
+
+	// Implicit only: average density error, as a fraction of the rest density, at which the iteration stops
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pressure Solver", meta = (ClampMin = "0.0001"))
+	float PressureTolerance;
+
+	// Implicit only: maximum number of Jacobi iterations per tick
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pressure Solver", meta = (ClampMin = "1"))
+	int32 MaxPressureIterations;
+
+	// Implicit only: Jacobi relaxation factor
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pressure Solver", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float PressureRelaxation;
+
+	// Implicit only: iterations used by the last tick
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Pressure Solver")
+	int32 PressureIterations;
+
+	// Implicit only: average density error after the last tick, as a fraction of the rest density
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Pressure Solver")
+	float PressureDensityError;
+
+	// Monaghan artificial viscosity strength (alpha); 0 disables it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Force Modules", meta = (ClampMin = "0.0"))
+	float ArtificialViscosity;
+
+	// XSPH velocity smoothing factor (epsilon); 0 disables it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Force Modules", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float XSPHFactor;
+
+	// Cohesion (surface tension) strength; 0 disables it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Force Modules", meta = (ClampMin = "0.0"))
+	float SurfaceTension;
+
+	// Sample the CPU time of each active force module into ForceModuleMs; adds a few percent to the neighbor pass
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Force Modules")
+	bool bProfileForceModules;
+
+	// CPU milliseconds spent in each active force module during the last tick; only filled while bProfileForceModules
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Force Modules", meta = (EditCondition = "bProfileForceModules"))
+	TMap<FName, float> ForceModuleMs;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bounding Box", meta = (ClampMin = "0.0", ClampMax = "1.0"))
 	float Restitution; // Measure of the elasticity of a collision particles interacting with this box (0.0 = no bounce, 1.0 = perfect bounce)
 
+	// Static mesh actors the particles collide with; baked into a signed distance field in the background after BeginPlay
+	// (or loaded from the cache), and ignored by the particles until that is done.
+	// Cooked builds need "Allow CPU Access" on their meshes.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colliders")
+	TArray<TObjectPtr<AActor>> ColliderActors;
+
+	// Grid spacing of the collider distance field; smaller follows the meshes more closely but takes longer to bake
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colliders", meta = (ClampMin = "0.1"))
+	float ColliderCellSize;
+
+	// Render the fluid as one marching cubes surface instead of a sphere per particle; the particle actors are hidden
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Surface")
+	bool bRenderSurface;
+
+	// Spacing of the grid the surface is extracted from
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Surface", meta = (ClampMin = "1.0"))
+	float SurfaceCellSize;
+
+	// Splatted density at the surface; a lone particle contributes 1 at its center, falling to 0 at SmoothingRadius
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Surface", meta = (ClampMin = "0.01", ClampMax = "1.0"))
+	float SurfaceIsoLevel;
+
+	// Parts of the surface are only re-meshed once one of their particles moved further than this
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Surface", meta = (ClampMin = "0.0"))
+	float SurfaceRemeshTolerance;
+
+	// Game thread time the surface mesher took last tick
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Surface")
+	float SurfaceMeshMs;
+
+	// Game thread time of the last surface mesh section upload; zero on ticks where the surface did not change
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Surface")
+	float SurfaceUploadMs;
+
+	// Triangles in the surface mesh
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Surface")
+	int32 SurfaceTriangles;
+
+	// Surface blocks re-meshed last tick, out of all blocks near a particle
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Surface")
+	int32 SurfaceDirtyBlocks;
+
+	UPROPERTY(VisibleAnywhere, Category = "Surface")
+	UProceduralMeshComponent *SurfaceMeshComponent;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Particle Properties")
 	float MinSpeedForColor;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Particle Properties")
 	float MaxSpeedForColor;
 
+	// Run the density and pressure neighbor loops, force modules included, on float32 positions and velocities and fp16
+	// densities to cut their memory traffic. Equation of state only; the implicit solver always uses full precision.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Performance")
+	bool bCompactNeighborState;
+
+	// Step the solver on a dedicated thread while the game thread renders the previous step; adds one frame of latency.
+	// Domain decomposition is not used while this is enabled.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Performance")
+	bool bAsyncSimulation;
+
+	// Frames between requesting an async step and displaying it
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Performance")
+	int32 AsyncLatencyFrames;
+
+	// Wall time between requesting an async step and displaying it
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Performance")
+	float AsyncLatencyMs;
+
+	// Solver time of the last async step; this no longer adds to the game thread frame time
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Performance")
+	float AsyncStepMs;
+
+	// Time the game thread had to wait because the async step was not finished yet
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Performance")
+	float AsyncGameThreadWaitMs;
+
+	// Number of slabs the box is split into along X, each stepped as its own rank with halo exchange; 1 disables decomposition.
+	// Equation of state only: the implicit solver would need ghost pressures every iteration, so it ignores this and logs an error
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Domain Decomposition", meta = (ClampMin = "1", EditCondition = "PressureSolver == EFluidPressureSolver::EquationOfState"))
+	int32 NumDomainRanks;
+
+	// Transport used to exchange halos and migrating particles between ranks; all ranks of the actor run in this process
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Domain Decomposition")
+	EFluidHaloTransportType DomainTransport;
+
 private:
 	TSubclassOf<AParticle> ParticleClass;
-	TArray<AParticle *> ManagedParticles; // Array to hold particle instances
-	TArray<float> DensitiesAroundParticle; // Array to hold particle densities // TODO store this on the particles themselves??
+	TArray<AParticle *> ManagedParticles; // Array to hold particle instances; index matches the particle index in Solver
+
+	FFluidSolver Solver; // Headless solver holding the simulation state of every managed particle
+	TUniquePtr<FFluidDomainDecomposition> DomainDecomposition; // Only set while NumDomainRanks > 1
+	TUniquePtr<FFluidAsyncSimulation> AsyncSimulation; // Only set while bAsyncSimulation is enabled during play
+	TSharedPtr<const FFluidSignedDistanceField> ColliderField; // Baked from ColliderActors after BeginPlay; null without colliders or until the bake is done
+	TFuture<TSharedPtr<const FFluidSignedDistanceField>> ColliderBake; // Load or bake of the collider field in flight on the thread pool
+	FFluidSurfaceMesher SurfaceMesher; // Keeps its blocks between ticks so only the parts that moved are re-meshed
+	FFluidSurfaceSection SurfaceSection; // Indexed upload of the mesher output into section 0 of SurfaceMeshComponent
 
 	void DrawBoundingRectangularPrism(); // Function to generate the mesh (if needed, similar to AParticle)
 
 	void SpawnParticles(); // Function to spawn particles within the bounding box
 
-	void ResolveBoundingBoxCollisions(float DeltaTime); // Function to update particle velocities based on gravity and other forces
+	void BakeColliders(); // Function to gather the ColliderActors' triangles and start loading or baking their distance field in the background
+
+	void ResolveBoundingBoxCollisions(float DeltaTime); // Function to update particle positions and bounce them off the bounding box
 
 	void DestroyAllParticles(); // Function to destroy all particles in the level; this is to avoid having any leftover particles from previous runs
 
-	/* Methods to calculate particle forces on each other */
-	float CalculateDensity(const FVector &SamplePoint); // Function to calculate the density at a given position based on particle positions
+	FFluidSolverParams MakeSolverParams() const; // Function to copy the editable simulation properties into solver parameters
+
+	void ValidateSolverSettings() const; // Function to report property combinations the solver cannot honour as set
+
+	void StepDomainDecomposition(float DeltaTime); // Function to step the solver state through the slab ranks, (re)creating them if needed
+
+	void StepAsyncSimulation(float DeltaTime); // Function to collect the last async step and request the next one, starting the thread if needed
 
-	float DensityToPressure(float Density); // Function to convert density to pressure based on target density and pressure factor
+	void UpdateParticleActors(); // Function to copy solver positions and velocities back to the particle actors
 
-	float CalculateSharedPressure(float Density1, float Density2); // Function to calculate shared pressure between two particles based on their densities
+	void UpdateSurfaceMesh(); // Function to re-mesh the fluid surface from the solver positions and upload it if it changed
 
-	FVector CalculatePressureForce(int ParticleIndex); // Function to calculate the pressure force on a particle based on its density and position relative to other particles
+	void SetParticleActorsHidden(bool bHidden); // Function to show or hide every particle actor
 };
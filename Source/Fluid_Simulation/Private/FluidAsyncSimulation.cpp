@@ -0,0 +1,123 @@
+#include "FluidAsyncSimulation.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+FFluidAsyncSimulation::FFluidAsyncSimulation(const FFluidSolver &InitialState)
+    : Solver(InitialState)
+    , LastParams(InitialState.Params)
+{
+    CommandEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    StepCompletedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    Thread = FRunnableThread::Create(this, TEXT("FluidSimulationThread"), 0, TPri_AboveNormal);
+}
+
+FFluidAsyncSimulation::~FFluidAsyncSimulation()
+{
+    if (Thread)
+    {
+        Thread->Kill(true); // Calls Stop() and waits for Run() to return
+        delete Thread;
+        Thread = nullptr;
+    }
+
+    FPlatformProcess::ReturnSynchEventToPool(CommandEvent);
+    FPlatformProcess::ReturnSynchEventToPool(StepCompletedEvent);
+}
+
+void FFluidAsyncSimulation::SetParams(const FFluidSolverParams &Params)
+{
+    if (Params == LastParams)
+    {
+        return;
+    }
+    LastParams = Params;
+
+    FCommand Command;
+    Command.Type = FCommand::EType::SetParams;
+    Command.Params = Params;
+    Commands.Enqueue(MoveTemp(Command));
+    CommandEvent->Trigger();
+}
+
+void FFluidAsyncSimulation::Tick(float DeltaTime, uint64 FrameIndex, TArray<FVector> &OutPositions, TArray<FVector> &OutVelocities)
+{
+    // Collect the step requested last frame; it has been running while the game thread rendered
+    if (NumStepsInFlight.load() > 0)
+    {
+        double WaitStartTime = FPlatformTime::Seconds();
+        while (NumStepsInFlight.load() > 0)
+        {
+            StepCompletedEvent->Wait();
+        }
+        Stats.GameThreadWaitMs = (FPlatformTime::Seconds() - WaitStartTime) * 1000.0;
+
+        Snapshots.SwapReadBuffers();
+        const FFluidSimulationSnapshot &Snapshot = Snapshots.Read();
+        OutPositions = Snapshot.Positions;
+        OutVelocities = Snapshot.Velocities;
+
+        Stats.LatencyFrames = (int32)(FrameIndex - Snapshot.RequestFrame);
+        Stats.LatencyMs = (FPlatformTime::Seconds() - Snapshot.RequestTime) * 1000.0;
+        Stats.StepMs = Snapshot.StepTime * 1000.0;
+        Stats.PressureStats = Snapshot.PressureStats;
+        Stats.ForceModuleStats = Snapshot.ForceModuleStats;
+    }
+
+    // Request the step for the next frame
+    FCommand Command;
+    Command.Type = FCommand::EType::Step;
+    Command.DeltaTime = DeltaTime;
+    Command.RequestFrame = FrameIndex;
+    Command.RequestTime = FPlatformTime::Seconds();
+
+    NumStepsInFlight.fetch_add(1);
+    Commands.Enqueue(MoveTemp(Command));
+    CommandEvent->Trigger();
+}
+
+uint32 FFluidAsyncSimulation::Run()
+{
+    while (!bStopRequested.load())
+    {
+        CommandEvent->Wait();
+
+        FCommand Command;
+        while (!bStopRequested.load() && Commands.Dequeue(Command))
+        {
+            if (Command.Type == FCommand::EType::SetParams)
+            {
+                Solver.Params = Command.Params;
+                continue;
+            }
+
+            double StepStartTime = FPlatformTime::Seconds();
+            Solver.Step(Command.DeltaTime);
+
+            FFluidSimulationSnapshot &Snapshot = Snapshots.GetWriteBuffer();
+            Snapshot.Positions = Solver.Positions;
+            Snapshot.Velocities = Solver.Velocities;
+            Snapshot.RequestFrame = Command.RequestFrame;
+            Snapshot.RequestTime = Command.RequestTime;
+            Snapshot.StepTime = FPlatformTime::Seconds() - StepStartTime;
+            Snapshot.PressureStats = Solver.PressureStats;
+            Snapshot.ForceModuleStats = Solver.ForceModuleStats;
+            Snapshots.SwapWriteBuffers();
+
+            NumStepsInFlight.fetch_sub(1);
+            StepCompletedEvent->Trigger();
+        }
+    }
+
+    // Never leave the game thread waiting on a step that will not run
+    NumStepsInFlight.store(0);
+    StepCompletedEvent->Trigger();
+    return 0;
+}
+
+void FFluidAsyncSimulation::Stop()
+{
+    bStopRequested.store(true);
+    CommandEvent->Trigger();
+}
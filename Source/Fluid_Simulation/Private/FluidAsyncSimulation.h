@@ -0,0 +1,85 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Containers/TripleBuffer.h"
+#include "FluidSolver.h"
+#include "HAL/Runnable.h"
+
+#include <atomic>
+
+// Particle state published by the simulation thread after each step
+struct FFluidSimulationSnapshot
+{
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	uint64 RequestFrame = 0; // Frame index the game thread passed to Tick when this step was requested
+	double RequestTime = 0.0; // FPlatformTime::Seconds() when this step was requested
+	double StepTime = 0.0; // Seconds the solver spent on this step
+	FFluidPressureSolveStats PressureStats;
+	TArray<FFluidForceModuleStats> ForceModuleStats;
+};
+
+// Timings measured by the game thread each time it consumes a snapshot
+struct FFluidAsyncSimulationStats
+{
+	int32 LatencyFrames = 0; // Frames between requesting a step and displaying its result
+	float LatencyMs = 0.0f; // Wall time between requesting a step and displaying its result
+	float StepMs = 0.0f; // Solver time of the displayed step, now hidden behind the game thread
+	float GameThreadWaitMs = 0.0f; // Time the game thread blocked because the step was not finished yet
+	FFluidPressureSolveStats PressureStats; // Implicit pressure convergence of the displayed step
+	TArray<FFluidForceModuleStats> ForceModuleStats; // Force module timings of the displayed step
+};
+
+// Runs FFluidSolver on a dedicated thread so the step for frame N+1 overlaps with the game thread rendering frame N.
+//
+// The game thread only talks to the simulation thread through a lock-free command queue (parameter changes and step
+// requests) and a triple-buffered snapshot of the particle state, so neither side ever takes a lock. At most one step
+// is in flight: if it has not finished by the next frame, the game thread waits for it, which bounds the added
+// latency to one frame.
+class FFluidAsyncSimulation : public FRunnable
+{
+public:
+	explicit FFluidAsyncSimulation(const FFluidSolver &InitialState);
+	virtual ~FFluidAsyncSimulation() override;
+
+	/* Game thread interface */
+	void SetParams(const FFluidSolverParams &Params); // Hand parameter changes over to the simulation thread
+
+	// Wait for the in-flight step, copy its result out and request the next step; FrameIndex is the caller's frame
+	// counter and only feeds LatencyFrames
+	void Tick(float DeltaTime, uint64 FrameIndex, TArray<FVector> &OutPositions, TArray<FVector> &OutVelocities);
+
+	const FFluidAsyncSimulationStats &GetStats() const { return Stats; }
+
+	/* FRunnable interface, called on the simulation thread */
+	virtual uint32 Run() override;
+
+	virtual void Stop() override;
+
+private:
+	struct FCommand
+	{
+		enum class EType : uint8 { SetParams, Step };
+
+		EType Type = EType::Step;
+		FFluidSolverParams Params; // SetParams only
+		float DeltaTime = 0.0f; // Step only
+		uint64 RequestFrame = 0;
+		double RequestTime = 0.0;
+	};
+
+	FFluidSolver Solver; // Only touched by the simulation thread once it has started
+	FFluidSolverParams LastParams; // Last parameters sent, game thread only
+
+	TQueue<FCommand, EQueueMode::Spsc> Commands;
+	TTripleBuffer<FFluidSimulationSnapshot> Snapshots;
+	std::atomic<int32> NumStepsInFlight { 0 };
+	std::atomic<bool> bStopRequested { false };
+
+	FEvent *CommandEvent = nullptr; // Triggered by the game thread when commands are queued
+	FEvent *StepCompletedEvent = nullptr; // Triggered by the simulation thread after publishing a snapshot
+	FRunnableThread *Thread = nullptr;
+
+	FFluidAsyncSimulationStats Stats;
+};
@@ -0,0 +1,875 @@
+#include "FluidBenchmarkCommandlet.h"
+
+#include "FluidAsyncSimulation.h"
+#include "FluidDomainDecomposition.h"
+#include "FluidForceModules.h"
+#include "FluidSignedDistanceField.h"
+#include "FluidSolver.h"
+#include "FluidSurfaceMesher.h"
+#include "FluidSurfaceSection.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "ProceduralMeshComponent.h"
+
+#if PLATFORM_LINUX
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const float BenchmarkDeltaTime = 1.0f / 60.0f;
+    const float BenchmarkGridSpacing = 20.0f;
+    const int32 BenchmarkSeed = 1337;
+
+    // Default scene settings from ABoundingRectangularPrism, with a box wide enough to split into many slabs
+    FFluidSolverParams MakeBenchmarkParams(float BoxExtentX)
+    {
+        FFluidSolverParams Params;
+        Params.BoxExtent = FVector(BoxExtentX, 200.0f, 200.0f);
+        Params.ParticleSpacing = BenchmarkGridSpacing;
+        return Params;
+    }
+
+    // Spawns the seeded benchmark block into a decomposition, steps once to warm up and returns the seconds NumSteps
+    // further steps take, or a negative time if a halo exchange failed. Every rank process spawns the same block and
+    // keeps only its own slab.
+    double TimeDecomposedSteps(FFluidDomainDecomposition &Decomposition, const FFluidSolverParams &Params, const FIntVector &CountPerAxis, int32 NumSteps)
+    {
+        FFluidSolver Scene;
+        FRandomStream RandomStream(BenchmarkSeed);
+        Scene.Params = Params;
+        Scene.SpawnParticleBlock(Params.BoxCenter, CountPerAxis, BenchmarkGridSpacing, 1.0f, RandomStream);
+
+        Decomposition.Initialize(Params, Scene.Positions, Scene.Velocities);
+        if (!Decomposition.Step(BenchmarkDeltaTime)) // Warm up so the first halo exchange is not timed
+        {
+            return -1.0;
+        }
+
+        double StartTime = FPlatformTime::Seconds();
+        for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+        {
+            if (!Decomposition.Step(BenchmarkDeltaTime))
+            {
+                return -1.0;
+            }
+        }
+        return FPlatformTime::Seconds() - StartTime;
+    }
+
+    struct FThroughput
+    {
+        double ParticleStepsPerSecond = 0.0;
+        double PairTestsPerSecond = 0.0; // Neighbor distance tests per second; the solver's cost scales with these, not with particles
+        int64 BytesPerStep = 0;
+    };
+
+    // Steps a decomposed scene with every rank in this process; all zero if a halo exchange failed
+    FThroughput MeasureThroughput(const FFluidSolverParams &Params, const FIntVector &CountPerAxis, int32 NumRanks, EFluidHaloTransportType Transport, int32 NumSteps)
+    {
+        FFluidDomainDecomposition Decomposition(NumRanks, Transport);
+        double ElapsedTime = TimeDecomposedSteps(Decomposition, Params, CountPerAxis, NumSteps);
+
+        FThroughput Throughput;
+        if (ElapsedTime < 0.0)
+        {
+            return Throughput;
+        }
+        ElapsedTime = FMath::Max(ElapsedTime, UE_DOUBLE_SMALL_NUMBER);
+        Throughput.ParticleStepsPerSecond = (double)Decomposition.GetNumParticles() * NumSteps / ElapsedTime;
+        Throughput.PairTestsPerSecond = (double)Decomposition.GetNeighborPairTestsLastStep() * NumSteps / ElapsedTime;
+        Throughput.BytesPerStep = Decomposition.GetBytesExchangedLastStep();
+        return Throughput;
+    }
+
+    void LogScalingMethod()
+    {
+        UE_LOG(LogTemp, Display, TEXT("  Neighbor search is all-pairs within each rank, so splitting a scene also cuts the pair tests per step:"));
+        UE_LOG(LogTemp, Display, TEXT("  particle-steps/s speedup mixes that algorithmic saving with parallelism. Pair tests/s (owned x (owned + ghost)"));
+        UE_LOG(LogTemp, Display, TEXT("  distance tests of the density and pressure passes) and its ratio to 1 rank measure parallel efficiency alone."));
+    }
+
+    // Latitude/longitude sphere with outward winding, the obstacle of the collider benchmark
+    void MakeSphereMesh(const FVector &Center, float Radius, int32 NumRings, int32 NumSegments, TArray<FVector> &OutVertices, TArray<int32> &OutIndices)
+    {
+        // Vertex 0 is the top pole, then NumRings - 1 rings of NumSegments vertices, then the bottom pole
+        OutVertices.Add(Center + FVector(0.0f, 0.0f, Radius));
+        for (int32 Ring = 1; Ring < NumRings; ++Ring)
+        {
+            double Theta = PI * Ring / NumRings;
+            for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+            {
+                double Phi = 2.0 * PI * Segment / NumSegments;
+                OutVertices.Add(Center + Radius * FVector(FMath::Sin(Theta) * FMath::Cos(Phi), FMath::Sin(Theta) * FMath::Sin(Phi), FMath::Cos(Theta)));
+            }
+        }
+        OutVertices.Add(Center - FVector(0.0f, 0.0f, Radius));
+
+        auto RingVertex = [&](int32 Ring, int32 Segment) { return 1 + (Ring - 1) * NumSegments + Segment % NumSegments; };
+        const int32 BottomPole = OutVertices.Num() - 1;
+        for (int32 Segment = 0; Segment < NumSegments; ++Segment)
+        {
+            OutIndices.Append({ 0, RingVertex(1, Segment), RingVertex(1, Segment + 1) });
+            for (int32 Ring = 1; Ring + 1 < NumRings; ++Ring)
+            {
+                OutIndices.Append({ RingVertex(Ring, Segment), RingVertex(Ring + 1, Segment), RingVertex(Ring, Segment + 1) });
+                OutIndices.Append({ RingVertex(Ring, Segment + 1), RingVertex(Ring + 1, Segment), RingVertex(Ring + 1, Segment + 1) });
+            }
+            OutIndices.Append({ RingVertex(NumRings - 1, Segment), BottomPole, RingVertex(NumRings - 1, Segment + 1) });
+        }
+    }
+}
+
+UFluidBenchmarkCommandlet::UFluidBenchmarkCommandlet()
+{
+    IsClient = false;
+    IsEditor = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 UFluidBenchmarkCommandlet::Main(const FString &Params)
+{
+    FString Mode = TEXT("scaling");
+    FParse::Value(*Params, TEXT("mode="), Mode);
+
+    if (Mode == TEXT("scaling"))
+    {
+        RunScalingBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("multiprocess"))
+    {
+        RunMultiProcessBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("rank"))
+    {
+        return RunRankProcess(Params);
+    }
+    if (Mode == TEXT("precision"))
+    {
+        RunPrecisionBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("async"))
+    {
+        RunAsyncBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("pressure"))
+    {
+        RunPressureBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("modules"))
+    {
+        RunForceModuleBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("colliders"))
+    {
+        RunColliderBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("surface"))
+    {
+        RunSurfaceBenchmark(Params);
+        return 0;
+    }
+    if (Mode == TEXT("halofailure"))
+    {
+        return RunHaloFailureCheck(Params);
+    }
+
+    UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: unknown mode '%s'."), *Mode);
+    return 1;
+}
+
+void UFluidBenchmarkCommandlet::RunScalingBenchmark(const FString &Params)
+{
+    int32 MaxRanks = 8;
+    int32 NumSteps = 20;
+    int32 CountPerAxis = 12; // Strong scaling scene is CountPerAxis^3 particles, weak scaling uses that much per rank
+    FString TransportName = TEXT("inprocess");
+    FParse::Value(*Params, TEXT("ranks="), MaxRanks);
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+    FParse::Value(*Params, TEXT("transport="), TransportName);
+
+    EFluidHaloTransportType Transport = TransportName.Equals(TEXT("unixsocket"), ESearchCase::IgnoreCase)
+        ? EFluidHaloTransportType::UnixSocket
+        : EFluidHaloTransportType::InProcess;
+
+    // Strong scaling: one fixed scene split across more and more ranks
+    const FFluidSolverParams StrongParams = MakeBenchmarkParams(200.0f);
+    MaxRanks = FMath::Clamp(MaxRanks, 1, FFluidDomainDecomposition::GetMaxRanks(StrongParams));
+    FThroughput StrongBaseline;
+
+    UE_LOG(LogTemp, Display, TEXT("Strong scaling: %d particles, %d steps, transport %s"), CountPerAxis * CountPerAxis * CountPerAxis, NumSteps, *TransportName);
+    UE_LOG(LogTemp, Display, TEXT("  Ranks are tasks of this process and share its task pool with the solver's own ParallelFor loops."));
+    LogScalingMethod();
+    UE_LOG(LogTemp, Display, TEXT("  Ranks  Particle-steps/s  Speedup  Pair tests/s  Pair speedup  Halo bytes/step"));
+    for (int32 NumRanks = 1; NumRanks <= MaxRanks; NumRanks *= 2)
+    {
+        FThroughput Throughput = MeasureThroughput(StrongParams, FIntVector(CountPerAxis), NumRanks, Transport, NumSteps);
+        StrongBaseline = (NumRanks == 1) ? Throughput : StrongBaseline;
+        UE_LOG(LogTemp, Display, TEXT("  %5d  %16.0f  %7.2f  %12.3e  %12.2f  %15lld"), NumRanks, Throughput.ParticleStepsPerSecond, Throughput.ParticleStepsPerSecond / StrongBaseline.ParticleStepsPerSecond,
+            Throughput.PairTestsPerSecond, Throughput.PairTestsPerSecond / StrongBaseline.PairTestsPerSecond, Throughput.BytesPerStep);
+    }
+
+    // Weak scaling: the box and the particle block grow along X with the rank count, particles per rank stay fixed
+    FThroughput WeakBaseline;
+
+    UE_LOG(LogTemp, Display, TEXT("Weak scaling: %d particles per rank, %d steps, transport %s"), CountPerAxis * CountPerAxis * CountPerAxis, NumSteps, *TransportName);
+    UE_LOG(LogTemp, Display, TEXT("  Efficiency is throughput over NumRanks x the 1 rank throughput; pair efficiency uses pair tests/s."));
+    UE_LOG(LogTemp, Display, TEXT("  Ranks  Particle-steps/s  Efficiency  Pair tests/s  Pair efficiency  Halo bytes/step"));
+    for (int32 NumRanks = 1; NumRanks <= MaxRanks; NumRanks *= 2)
+    {
+        const FFluidSolverParams WeakParams = MakeBenchmarkParams(CountPerAxis * BenchmarkGridSpacing * NumRanks / 2.0f + 20.0f);
+        FThroughput Throughput = MeasureThroughput(WeakParams, FIntVector(CountPerAxis * NumRanks, CountPerAxis, CountPerAxis), NumRanks, Transport, NumSteps);
+        WeakBaseline = (NumRanks == 1) ? Throughput : WeakBaseline;
+        UE_LOG(LogTemp, Display, TEXT("  %5d  %16.0f  %10.2f  %12.3e  %15.2f  %15lld"), NumRanks, Throughput.ParticleStepsPerSecond, Throughput.ParticleStepsPerSecond / (WeakBaseline.ParticleStepsPerSecond * NumRanks),
+            Throughput.PairTestsPerSecond, Throughput.PairTestsPerSecond / (WeakBaseline.PairTestsPerSecond * NumRanks), Throughput.BytesPerStep);
+    }
+}
+
+void UFluidBenchmarkCommandlet::RunMultiProcessBenchmark(const FString &Params)
+{
+    int32 MaxRanks = 4;
+    int32 NumSteps = 20;
+    int32 CountPerAxis = 12;
+    FParse::Value(*Params, TEXT("ranks="), MaxRanks);
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+
+    const FFluidSolverParams SceneParams = MakeBenchmarkParams(200.0f);
+    MaxRanks = FMath::Clamp(MaxRanks, 1, FFluidDomainDecomposition::GetMaxRanks(SceneParams));
+    const int32 NumParticles = CountPerAxis * CountPerAxis * CountPerAxis;
+
+    // Socket paths must fit in sun_path, so the rendezvous directory lives in the short temp directory
+    const FString SocketDirectory = FPaths::Combine(FPlatformProcess::UserTempDir(), FString::Printf(TEXT("FluidRanks%u"), FPlatformProcess::GetCurrentProcessId()));
+    const FString ProjectPath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+    FThroughput Baseline;
+
+    UE_LOG(LogTemp, Display, TEXT("Multi-process strong scaling: %d particles, %d steps, one process per rank over named Unix sockets"), NumParticles, NumSteps);
+    LogScalingMethod();
+    UE_LOG(LogTemp, Display, TEXT("  Ranks  Particle-steps/s  Speedup  Pair tests/s  Pair speedup  Halo bytes/step"));
+    for (int32 NumRanks = 1; NumRanks <= MaxRanks; NumRanks *= 2)
+    {
+        IFileManager::Get().DeleteDirectory(*SocketDirectory, false, true);
+        IFileManager::Get().MakeDirectory(*SocketDirectory, true);
+
+        TArray<FProcHandle> Processes;
+        for (int32 Rank = 0; Rank < NumRanks; ++Rank)
+        {
+            FString RankArgs = FString::Printf(TEXT("\"%s\" -run=FluidBenchmark -mode=rank -rank=%d -ranks=%d -steps=%d -particlesperaxis=%d -socketdir=\"%s\" -unattended -nullrhi"),
+                *ProjectPath, Rank, NumRanks, NumSteps, CountPerAxis, *SocketDirectory);
+            Processes.Add(FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *RankArgs, false, true, true, nullptr, 0, nullptr, nullptr));
+        }
+
+        bool bSucceeded = true;
+        for (FProcHandle &Process : Processes)
+        {
+            int32 ReturnCode = 1;
+            bSucceeded &= Process.IsValid();
+            if (Process.IsValid())
+            {
+                FPlatformProcess::WaitForProc(Process);
+                FPlatformProcess::GetProcReturnCode(Process, &ReturnCode);
+                FPlatformProcess::CloseProc(Process);
+            }
+            bSucceeded &= (ReturnCode == 0);
+        }
+
+        // Each rank wrote "<owned particles> <seconds> <halo bytes per step> <pair tests per step>"; the run is as slow
+        // as its slowest rank
+        int32 NumOwned = 0;
+        double ElapsedTime = 0.0;
+        int64 BytesPerStep = 0;
+        int64 PairTestsPerStep = 0;
+        for (int32 Rank = 0; Rank < NumRanks && bSucceeded; ++Rank)
+        {
+            FString Result;
+            TArray<FString> Fields;
+            bSucceeded = FFileHelper::LoadFileToString(Result, *FPaths::Combine(SocketDirectory, FString::Printf(TEXT("rank%d.result"), Rank)))
+                && Result.ParseIntoArrayWS(Fields) == 4;
+            if (bSucceeded)
+            {
+                NumOwned += FCString::Atoi(*Fields[0]);
+                ElapsedTime = FMath::Max(ElapsedTime, FCString::Atod(*Fields[1]));
+                BytesPerStep += FCString::Atoi64(*Fields[2]);
+                PairTestsPerStep += FCString::Atoi64(*Fields[3]);
+            }
+        }
+        IFileManager::Get().DeleteDirectory(*SocketDirectory, false, true);
+
+        if (!bSucceeded || NumOwned != NumParticles)
+        {
+            UE_LOG(LogTemp, Error, TEXT("  %5d  rank processes failed; see their logs"), NumRanks);
+            continue;
+        }
+
+        FThroughput Throughput;
+        ElapsedTime = FMath::Max(ElapsedTime, UE_DOUBLE_SMALL_NUMBER);
+        Throughput.ParticleStepsPerSecond = (double)NumParticles * NumSteps / ElapsedTime;
+        Throughput.PairTestsPerSecond = (double)PairTestsPerStep * NumSteps / ElapsedTime;
+        Baseline = (NumRanks == 1) ? Throughput : Baseline;
+        UE_LOG(LogTemp, Display, TEXT("  %5d  %16.0f  %7.2f  %12.3e  %12.2f  %15lld"), NumRanks, Throughput.ParticleStepsPerSecond,
+            Baseline.ParticleStepsPerSecond > 0.0 ? Throughput.ParticleStepsPerSecond / Baseline.ParticleStepsPerSecond : 0.0, Throughput.PairTestsPerSecond,
+            Baseline.PairTestsPerSecond > 0.0 ? Throughput.PairTestsPerSecond / Baseline.PairTestsPerSecond : 0.0, BytesPerStep);
+    }
+}
+
+int32 UFluidBenchmarkCommandlet::RunRankProcess(const FString &Params)
+{
+    int32 Rank = 0;
+    int32 NumRanks = 1;
+    int32 NumSteps = 20;
+    int32 CountPerAxis = 12;
+    double ConnectTimeout = 60.0; // Seconds to wait for the other rank processes to start
+    FString SocketDirectory;
+    FParse::Value(*Params, TEXT("rank="), Rank);
+    FParse::Value(*Params, TEXT("ranks="), NumRanks);
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+    FParse::Value(*Params, TEXT("timeout="), ConnectTimeout);
+    FParse::Value(*Params, TEXT("socketdir="), SocketDirectory);
+
+    if (SocketDirectory.IsEmpty() || NumRanks < 1 || Rank < 0 || Rank >= NumRanks)
+    {
+        UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: rank mode needs -rank=N -ranks=M with 0 <= N < M and -socketdir=<directory>."));
+        return 1;
+    }
+
+    TUniquePtr<IFluidHaloTransport> Transport = IFluidHaloTransport::CreateForProcess(Rank, NumRanks, SocketDirectory, ConnectTimeout);
+    if (!Transport.IsValid())
+    {
+        return 1;
+    }
+
+    FFluidDomainDecomposition Decomposition(NumRanks, Rank, MoveTemp(Transport));
+    double ElapsedTime = TimeDecomposedSteps(Decomposition, MakeBenchmarkParams(200.0f), FIntVector(CountPerAxis), NumSteps);
+    if (ElapsedTime < 0.0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: rank %d stopped after a failed halo exchange."), Rank);
+        return 1;
+    }
+
+    FString Result = FString::Printf(TEXT("%d %.9f %lld %lld"), Decomposition.GetNumOwned(Rank), ElapsedTime, Decomposition.GetBytesExchangedLastStep(), Decomposition.GetNeighborPairTestsLastStep());
+    if (!FFileHelper::SaveStringToFile(Result, *FPaths::Combine(SocketDirectory, FString::Printf(TEXT("rank%d.result"), Rank))))
+    {
+        UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: rank %d could not write its result to %s."), Rank, *SocketDirectory);
+        return 1;
+    }
+    UE_LOG(LogTemp, Display, TEXT("Rank %d/%d: %d particles, %d steps in %.3f s"), Rank, NumRanks, Decomposition.GetNumOwned(Rank), NumSteps, ElapsedTime);
+    return 0;
+}
+
+void UFluidBenchmarkCommandlet::RunPrecisionBenchmark(const FString &Params)
+{
+    int32 NumSteps = 120;
+    int32 CountPerAxis = 10;
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+
+    // Both solvers start from the same jittered block; the prism sits far from the world origin on purpose so
+    // the compact path has to rely on origin-relative positions
+    FFluidSolver InitialState;
+    FRandomStream RandomStream(BenchmarkSeed);
+    InitialState.Params = MakeBenchmarkParams(200.0f);
+    InitialState.Params.BoxCenter = FVector(100000.0f, -50000.0f, 2000.0f);
+    InitialState.SpawnParticleBlock(InitialState.Params.BoxCenter, FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+    RegisterDefaultFluidForceModules(InitialState);
+
+    UE_LOG(LogTemp, Display, TEXT("Compact neighbor state: %d particles, %d steps"), InitialState.NumOwned, NumSteps);
+    UE_LOG(LogTemp, Display, TEXT("  Resident bytes/particle: measured heap use of the solver's particle arrays, compact copy and scratch."));
+    UE_LOG(LogTemp, Display, TEXT("  Neighbor bytes/pair: bytes read per neighbor per step by the density and pressure passes, from the layouts."));
+    // fp16 has its normal range above 6e-5, and raw kernel densities shrink with the radius squared, so the sweep
+    // goes to radii where unscaled densities would be subnormal; the round trip row shows what the scaling saves
+    for (float SmoothingRadius : { 25.0f, 100.0f, 400.0f })
+    {
+        FFluidSolver RadiusState = InitialState;
+        RadiusState.Params.SmoothingRadius = SmoothingRadius;
+        RadiusState.CalculateDensities();
+
+        FFluidCompactParticleState ScaledDensities;
+        FFluidCompactParticleState RawDensities;
+        ScaledDensities.PackDensities(RadiusState.DensitiesAroundParticle, FFluidSolver::CalculateSelfDensity(SmoothingRadius));
+        RawDensities.PackDensities(RadiusState.DensitiesAroundParticle, 1.0f);
+        double MaxScaledError = 0.0;
+        double MaxRawError = 0.0;
+        for (int32 Index = 0; Index < RadiusState.DensitiesAroundParticle.Num(); ++Index)
+        {
+            const double Density = FMath::Max((double)RadiusState.DensitiesAroundParticle[Index], UE_DOUBLE_SMALL_NUMBER);
+            MaxScaledError = FMath::Max(MaxScaledError, FMath::Abs(ScaledDensities.GetDensity(Index) - Density) / Density);
+            MaxRawError = FMath::Max(MaxRawError, FMath::Abs(RawDensities.GetDensity(Index) - Density) / Density);
+        }
+
+        UE_LOG(LogTemp, Display, TEXT("  Smoothing radius %.0f: fp16 density round trip max error %.4f%% scaled by W(0), %.4f%% unscaled"),
+            SmoothingRadius, MaxScaledError * 100.0, MaxRawError * 100.0);
+        for (bool bModulesEnabled : { false, true })
+        {
+            // Same module settings as the modules benchmark; with them on, velocities enter the neighbor loop too
+            FFluidSolver FullSolver = RadiusState;
+            if (bModulesEnabled)
+            {
+                FullSolver.Params.ArtificialViscosity = 0.1f;
+                FullSolver.Params.XSPHFactor = 0.05f;
+                FullSolver.Params.SurfaceTension = 1.0f;
+            }
+            FFluidSolver CompactSolver = FullSolver;
+            CompactSolver.Params.bCompactNeighborState = true;
+
+            double FullTime = 0.0;
+            double CompactTime = 0.0;
+            for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+            {
+                double StartTime = FPlatformTime::Seconds();
+                FullSolver.Step(BenchmarkDeltaTime);
+                FullTime += FPlatformTime::Seconds() - StartTime;
+
+                StartTime = FPlatformTime::Seconds();
+                CompactSolver.Step(BenchmarkDeltaTime);
+                CompactTime += FPlatformTime::Seconds() - StartTime;
+            }
+
+            double SumSquaredPositionError = 0.0;
+            double MaxPositionError = 0.0;
+            double SumRelativeDensityError = 0.0;
+            double MaxRelativeDensityError = 0.0;
+            for (int32 Index = 0; Index < FullSolver.NumOwned; ++Index)
+            {
+                double PositionError = FVector::Distance(FullSolver.Positions[Index], CompactSolver.Positions[Index]);
+                SumSquaredPositionError += PositionError * PositionError;
+                MaxPositionError = FMath::Max(MaxPositionError, PositionError);
+
+                double FullDensity = FullSolver.DensitiesAroundParticle[Index];
+                double DensityError = FMath::Abs(FullDensity - CompactSolver.DensitiesAroundParticle[Index]) / FMath::Max(FullDensity, UE_DOUBLE_SMALL_NUMBER);
+                SumRelativeDensityError += DensityError;
+                MaxRelativeDensityError = FMath::Max(MaxRelativeDensityError, DensityError);
+            }
+            int32 NumParticles = FMath::Max(1, FullSolver.NumOwned);
+
+            // Density pass reads positions; pressure pass reads positions and densities, plus velocities for the modules
+            auto GetNeighborBytes = [bModulesEnabled](bool bCompact)
+                {
+                    const int32 PositionBytes = bCompact ? 3 * (int32)sizeof(float) : (int32)sizeof(FVector);
+                    const int32 DensityBytes = bCompact ? (int32)sizeof(FFloat16) : (int32)sizeof(float);
+                    const int32 VelocityBytes = bModulesEnabled ? PositionBytes : 0; // Same layout as the positions
+                    return 2 * PositionBytes + DensityBytes + VelocityBytes;
+                };
+
+            UE_LOG(LogTemp, Display, TEXT("    Force modules %s"), bModulesEnabled ? TEXT("on") : TEXT("off"));
+            UE_LOG(LogTemp, Display, TEXT("      Mode     Resident bytes/particle  Neighbor bytes/pair  ms/step"));
+            UE_LOG(LogTemp, Display, TEXT("      Full     %23.1f  %19d  %7.3f"), (double)FullSolver.GetAllocatedSize() / NumParticles, GetNeighborBytes(false), FullTime * 1000.0 / NumSteps);
+            UE_LOG(LogTemp, Display, TEXT("      Compact  %23.1f  %19d  %7.3f"), (double)CompactSolver.GetAllocatedSize() / NumParticles, GetNeighborBytes(true), CompactTime * 1000.0 / NumSteps);
+            UE_LOG(LogTemp, Display, TEXT("      Position drift: RMS %.4f, max %.4f (particle radius %.1f)"), FMath::Sqrt(SumSquaredPositionError / NumParticles), MaxPositionError, FullSolver.Params.ParticleRadius);
+            UE_LOG(LogTemp, Display, TEXT("      Density error: mean %.4f%%, max %.4f%%"), SumRelativeDensityError * 100.0 / NumParticles, MaxRelativeDensityError * 100.0);
+        }
+    }
+}
+
+void UFluidBenchmarkCommandlet::RunAsyncBenchmark(const FString &Params)
+{
+    int32 NumSteps = 120;
+    int32 CountPerAxis = 10;
+    float RenderMs = 8.0f; // Game thread work per frame that the async step can hide behind
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+    FParse::Value(*Params, TEXT("renderms="), RenderMs);
+
+    FFluidSolver Solver;
+    FRandomStream RandomStream(BenchmarkSeed);
+    Solver.Params = MakeBenchmarkParams(200.0f);
+    Solver.SpawnParticleBlock(Solver.Params.BoxCenter, FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+
+    // Synchronous: solver time adds directly to the frame
+    FFluidSolver SyncSolver = Solver;
+    double StartTime = FPlatformTime::Seconds();
+    for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+    {
+        SyncSolver.Step(BenchmarkDeltaTime);
+        FPlatformProcess::Sleep(RenderMs / 1000.0f);
+    }
+    double SyncFrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumSteps;
+
+    // Async: the step for the next frame runs while the game thread "renders"; the commandlet has no engine loop,
+    // so the loop index stands in for the frame counter
+    FFluidAsyncSimulation AsyncSimulation(Solver);
+    TArray<FVector> Positions = Solver.Positions;
+    TArray<FVector> Velocities = Solver.Velocities;
+    double SumLatencyMs = 0.0;
+    int32 MaxLatencyFrames = 0;
+
+    StartTime = FPlatformTime::Seconds();
+    for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+    {
+        AsyncSimulation.Tick(BenchmarkDeltaTime, StepIndex, Positions, Velocities);
+        SumLatencyMs += AsyncSimulation.GetStats().LatencyMs;
+        MaxLatencyFrames = FMath::Max(MaxLatencyFrames, AsyncSimulation.GetStats().LatencyFrames);
+        FPlatformProcess::Sleep(RenderMs / 1000.0f);
+    }
+    double AsyncFrameMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumSteps;
+
+    UE_LOG(LogTemp, Display, TEXT("Async simulation: %d particles, %d frames, %.1f ms simulated render work per frame"), Solver.NumOwned, NumSteps, RenderMs);
+    UE_LOG(LogTemp, Display, TEXT("  Sync frame time:  %.3f ms"), SyncFrameMs);
+    UE_LOG(LogTemp, Display, TEXT("  Async frame time: %.3f ms"), AsyncFrameMs);
+    UE_LOG(LogTemp, Display, TEXT("  Async latency: mean %.3f ms, max %d frames"), SumLatencyMs / FMath::Max(1, NumSteps - 1), MaxLatencyFrames);
+}
+
+void UFluidBenchmarkCommandlet::RunPressureBenchmark(const FString &Params)
+{
+    float SimulatedSeconds = 2.0f;
+    float BaseDeltaTime = 0.004f;
+    int32 CountPerAxis = 8;
+    FParse::Value(*Params, TEXT("seconds="), SimulatedSeconds);
+    FParse::Value(*Params, TEXT("basedt="), BaseDeltaTime);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+
+    FFluidSolver InitialState;
+    FRandomStream RandomStream(BenchmarkSeed);
+    InitialState.Params = MakeBenchmarkParams(200.0f);
+    InitialState.SpawnParticleBlock(InitialState.Params.BoxCenter, FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+
+    // A scene is unstable once anything leaves the box at a speed no amount of gravity could produce
+    const float MaxPlausibleSpeed = 50.0f * InitialState.Params.Gravity;
+
+    // Both solvers are driven towards and measured against the same rest density: the implicit solver's, which the
+    // equation of state gets as its TargetDensity (in unit mass kernel units, like the densities it compares it to)
+    const float RestDensity = InitialState.GetImplicitRestDensity();
+    InitialState.Params.TargetDensity = RestDensity / InitialState.Params.ParticleMass;
+
+    UE_LOG(LogTemp, Display, TEXT("Pressure solvers: %d particles, %.1f simulated seconds, rest density %g"), InitialState.NumOwned, SimulatedSeconds, RestDensity);
+    UE_LOG(LogTemp, Display, TEXT("  Max |error| is the worst density deviation of any particle in any step; mean compression averages the"));
+    UE_LOG(LogTemp, Display, TEXT("  excess density over all particles and steps, the quantity the implicit solver drives below its tolerance."));
+    UE_LOG(LogTemp, Display, TEXT("  Solver    dt (ms)  Steps  Stable  Max |error|  Mean compression  Solver error  Max pressure  Mean iterations  Wall ms"));
+    for (EFluidPressureSolver PressureSolver : { EFluidPressureSolver::EquationOfState, EFluidPressureSolver::Implicit })
+    {
+        const bool bImplicit = PressureSolver == EFluidPressureSolver::Implicit;
+        for (int32 Multiplier : { 1, 5, 10 })
+        {
+            FFluidSolver Solver = InitialState;
+            Solver.Params.PressureSolver = PressureSolver;
+            const float DeltaTime = BaseDeltaTime * Multiplier;
+            const int32 NumSteps = FMath::Max(1, FMath::RoundToInt(SimulatedSeconds / DeltaTime));
+
+            bool bStable = true;
+            int32 StepsRun = 0;
+            int64 TotalIterations = 0;
+            double SumSolverError = 0.0;
+            double SumCompression = 0.0;
+            float MaxAbsoluteError = 0.0f;
+            float MaxPressure = 0.0f;
+            double WallTime = 0.0;
+            for (int32 StepIndex = 0; StepIndex < NumSteps && bStable; ++StepIndex)
+            {
+                double StartTime = FPlatformTime::Seconds();
+                Solver.Step(DeltaTime);
+                WallTime += FPlatformTime::Seconds() - StartTime;
+                ++StepsRun;
+
+                TotalIterations += Solver.PressureStats.Iterations;
+                SumSolverError += Solver.PressureStats.DensityError;
+                for (float Pressure : Solver.Pressures)
+                {
+                    MaxPressure = FMath::Max(MaxPressure, Pressure);
+                }
+
+                // Densities of this step, sampled before integration
+                double StepCompression = 0.0;
+                for (int32 Index = 0; Index < Solver.NumOwned; ++Index)
+                {
+                    const float Error = (Solver.Params.ParticleMass * Solver.DensitiesAroundParticle[Index] - RestDensity) / RestDensity;
+                    MaxAbsoluteError = FMath::Max(MaxAbsoluteError, FMath::Abs(Error));
+                    StepCompression += FMath::Max(Error, 0.0f);
+                }
+                SumCompression += StepCompression / FMath::Max(1, Solver.NumOwned);
+
+                for (const FVector &Velocity : Solver.Velocities)
+                {
+                    bStable &= !Velocity.ContainsNaN() && Velocity.Size() < MaxPlausibleSpeed;
+                }
+            }
+
+            UE_LOG(LogTemp, Display, TEXT("  %-8s  %7.2f  %5d  %6s  %10.2f%%  %15.2f%%  %11s  %12s  %15s  %7.0f"),
+                bImplicit ? TEXT("IISPH") : TEXT("EOS"), DeltaTime * 1000.0f, StepsRun, bStable ? TEXT("yes") : TEXT("no"),
+                MaxAbsoluteError * 100.0f, SumCompression * 100.0 / StepsRun,
+                bImplicit ? *FString::Printf(TEXT("%.2f%%"), SumSolverError * 100.0 / StepsRun) : TEXT("-"),
+                bImplicit ? *FString::Printf(TEXT("%.3g"), MaxPressure) : TEXT("-"),
+                bImplicit ? *FString::Printf(TEXT("%.1f"), (double)TotalIterations / StepsRun) : TEXT("-"),
+                WallTime * 1000.0);
+
+            // An implicit solve that never produces pressure converges instantly and makes the comparison meaningless
+            if (bImplicit && MaxPressure <= 0.0f)
+            {
+                UE_LOG(LogTemp, Warning, TEXT("  IISPH produced no pressure at dt %.2f ms; the rest density %g is never reached."), DeltaTime * 1000.0f, RestDensity);
+            }
+        }
+    }
+}
+
+void UFluidBenchmarkCommandlet::RunForceModuleBenchmark(const FString &Params)
+{
+    int32 NumSteps = 60;
+    int32 CountPerAxis = 10;
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+
+    FFluidSolver InitialState;
+    FRandomStream RandomStream(BenchmarkSeed);
+    InitialState.Params = MakeBenchmarkParams(200.0f);
+    InitialState.SpawnParticleBlock(InitialState.Params.BoxCenter, FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+    RegisterDefaultFluidForceModules(InitialState);
+
+    UE_LOG(LogTemp, Display, TEXT("Force modules: %d particles, %d steps"), InitialState.NumOwned, NumSteps);
+    for (bool bModulesEnabled : { false, true })
+    {
+        FFluidSolver Solver = InitialState;
+        if (bModulesEnabled)
+        {
+            Solver.Params.ArtificialViscosity = 0.1f;
+            Solver.Params.XSPHFactor = 0.05f;
+            Solver.Params.SurfaceTension = 1.0f;
+        }
+
+        // The step time is taken without profiling; the per-module split comes from a profiled replay of the same steps
+        FFluidSolver ProfiledSolver = Solver;
+        ProfiledSolver.Params.bProfileForceModules = true;
+
+        double StartTime = FPlatformTime::Seconds();
+        for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+        {
+            Solver.Step(BenchmarkDeltaTime);
+        }
+        double StepMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumSteps;
+
+        TMap<FName, double> ModuleMs;
+        for (int32 StepIndex = 0; bModulesEnabled && StepIndex < NumSteps; ++StepIndex)
+        {
+            ProfiledSolver.Step(BenchmarkDeltaTime);
+            for (const FFluidForceModuleStats &Stats : ProfiledSolver.ForceModuleStats)
+            {
+                ModuleMs.FindOrAdd(Stats.Name) += Stats.Ms;
+            }
+        }
+
+        UE_LOG(LogTemp, Display, TEXT("  Modules %s: %.3f ms/step"), bModulesEnabled ? TEXT("on ") : TEXT("off"), StepMs);
+        for (const TPair<FName, double> &Entry : ModuleMs)
+        {
+            UE_LOG(LogTemp, Display, TEXT("    %-10s %.3f CPU ms/step"), *Entry.Key.ToString(), Entry.Value / NumSteps);
+        }
+    }
+}
+
+void UFluidBenchmarkCommandlet::RunColliderBenchmark(const FString &Params)
+{
+    int32 NumRepeats = 200;
+    int32 NumSteps = 120;
+    int32 CountPerAxis = 10;
+    float CellSize = 5.0f;
+    FParse::Value(*Params, TEXT("repeats="), NumRepeats);
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+    FParse::Value(*Params, TEXT("cellsize="), CellSize);
+
+    FFluidSolver InitialState;
+    FRandomStream RandomStream(BenchmarkSeed);
+    InitialState.Params = MakeBenchmarkParams(200.0f);
+
+    // A sphere in the lower half of the box with the particle block falling onto it
+    const FVector SphereCenter = InitialState.Params.BoxCenter + FVector(0.0f, 0.0f, -60.0f);
+    const float SphereRadius = 80.0f;
+    TArray<FVector> Vertices;
+    TArray<int32> Indices;
+    MakeSphereMesh(SphereCenter, SphereRadius, 32, 64, Vertices, Indices);
+    InitialState.SpawnParticleBlock(InitialState.Params.BoxCenter + FVector(0.0f, 0.0f, 80.0f), FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+
+    // Start from an empty cache so the first load has to bake
+    const float BandWidth = InitialState.Params.ParticleRadius + 2.0f * CellSize;
+    const FString CacheDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("FluidSDF"), TEXT("Benchmark"));
+    IFileManager::Get().DeleteDirectory(*CacheDirectory, false, true);
+
+    double StartTime = FPlatformTime::Seconds();
+    TSharedPtr<const FFluidSignedDistanceField> Field = FFluidSignedDistanceField::LoadOrBake(Vertices, Indices, CellSize, BandWidth, CacheDirectory);
+    double BakeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    StartTime = FPlatformTime::Seconds();
+    Field = FFluidSignedDistanceField::LoadOrBake(Vertices, Indices, CellSize, BandWidth, CacheDirectory);
+    double LoadMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    if (!Field.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: could not bake the collider distance field."));
+        return;
+    }
+
+    UE_LOG(LogTemp, Display, TEXT("Colliders: sphere of %d triangles, cell size %.1f, %d particles"), Indices.Num() / 3, CellSize, InitialState.NumOwned);
+    UE_LOG(LogTemp, Display, TEXT("  Bake (cache miss): %.1f ms"), BakeMs);
+    UE_LOG(LogTemp, Display, TEXT("  Load (cache hit):  %.1f ms"), LoadMs);
+    UE_LOG(LogTemp, Display, TEXT("  Bricks: %d of %d allocated, %.1f KB"), Field->GetNumAllocatedBricks(), Field->GetNumBricks(), Field->GetAllocatedSize() / 1024.0);
+
+    // Collision pass alone; a zero time step keeps every repeat resolving the same positions
+    UE_LOG(LogTemp, Display, TEXT("  Colliders     ns/particle"));
+    for (bool bWithField : { false, true })
+    {
+        FFluidSolver Solver = InitialState;
+        Solver.Params.SignedDistanceField = bWithField ? Field : nullptr;
+
+        StartTime = FPlatformTime::Seconds();
+        for (int32 RepeatIndex = 0; RepeatIndex < NumRepeats; ++RepeatIndex)
+        {
+            Solver.ResolveBoundingBoxCollisions(0.0f);
+        }
+        double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+
+        UE_LOG(LogTemp, Display, TEXT("  %-12s  %11.2f"), bWithField ? TEXT("Box + SDF") : TEXT("Box"), ElapsedTime * 1.0e9 / ((double)NumRepeats * FMath::Max(1, Solver.NumOwned)));
+    }
+
+    // Full simulation against the sphere; no particle should end up inside it
+    FFluidSolver Solver = InitialState;
+    Solver.Params.SignedDistanceField = Field;
+    for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+    {
+        Solver.Step(BenchmarkDeltaTime);
+    }
+
+    int32 NumInside = 0;
+    double MaxPenetration = 0.0;
+    for (int32 Index = 0; Index < Solver.NumOwned; ++Index)
+    {
+        double Penetration = SphereRadius - FVector::Distance(Solver.Positions[Index], SphereCenter);
+        NumInside += (Penetration > 0.0) ? 1 : 0;
+        MaxPenetration = FMath::Max(MaxPenetration, Penetration);
+    }
+    UE_LOG(LogTemp, Display, TEXT("  After %d steps: %d particles inside the sphere, max penetration %.2f"), NumSteps, NumInside, MaxPenetration);
+
+    // Particles started far deeper than BandWidth, down to the sphere's center, where every sample is clamped; one
+    // collision pass has to move them all out
+    FFluidSolver DeepSolver;
+    DeepSolver.Params = InitialState.Params;
+    DeepSolver.Params.SignedDistanceField = Field;
+    for (float Depth : { 0.5f * BandWidth, 2.0f * BandWidth, 0.5f * SphereRadius, SphereRadius - 1.0f })
+    {
+        for (const FVector &Direction : { FVector::UpVector, FVector(1.0, 1.0, -1.0).GetSafeNormal() })
+        {
+            DeepSolver.AddParticle(SphereCenter + Direction * (SphereRadius - Depth), FVector::ZeroVector);
+        }
+    }
+    DeepSolver.ResolveBoundingBoxCollisions(0.0f);
+
+    int32 NumDeepInside = 0;
+    for (int32 Index = 0; Index < DeepSolver.NumOwned; ++Index)
+    {
+        NumDeepInside += (FVector::Distance(DeepSolver.Positions[Index], SphereCenter) < SphereRadius) ? 1 : 0;
+    }
+    UE_LOG(LogTemp, Display, TEXT("  Deep start: %d of %d particles started up to %.0f inside are still inside after one pass (%s)"),
+        NumDeepInside, DeepSolver.NumOwned, SphereRadius - 1.0f, NumDeepInside == 0 ? TEXT("ok") : TEXT("FAILED"));
+}
+
+void UFluidBenchmarkCommandlet::RunSurfaceBenchmark(const FString &Params)
+{
+    int32 NumSteps = 120;
+    int32 CountPerAxis = 12;
+    float CellSize = 8.0f;
+    FParse::Value(*Params, TEXT("steps="), NumSteps);
+    FParse::Value(*Params, TEXT("particlesperaxis="), CountPerAxis);
+    FParse::Value(*Params, TEXT("cellsize="), CellSize);
+
+    FFluidSolver Solver;
+    FRandomStream RandomStream(BenchmarkSeed);
+    Solver.Params = MakeBenchmarkParams(200.0f);
+    Solver.SpawnParticleBlock(Solver.Params.BoxCenter, FIntVector(CountPerAxis), BenchmarkGridSpacing, 1.0f, RandomStream);
+
+    // Both meshers see the same frames; the full one is reset every frame so it re-meshes every block
+    FFluidSurfaceMesher IncrementalMesher;
+    FFluidSurfaceMesher FullMesher;
+    IncrementalMesher.Params.CellSize = CellSize;
+    IncrementalMesher.Params.KernelRadius = Solver.Params.SmoothingRadius;
+    FullMesher.Params = IncrementalMesher.Params;
+
+    // The incremental mesh is uploaded like the actor does, into a component that is never registered, so only the
+    // game thread side of the upload is timed; the render thread copy to the GPU is estimated from the bytes sent
+    UProceduralMeshComponent *SurfaceComponent = NewObject<UProceduralMeshComponent>(GetTransientPackage());
+    FFluidSurfaceSection SurfaceSection;
+
+    double IncrementalMs = 0.0;
+    double FullMs = 0.0;
+    int64 DirtyBlocks = 0;
+    int64 TotalBlocks = 0;
+    double UploadMs = 0.0;
+    int64 UploadBytes = 0;
+    int64 UnindexedBytes = 0; // What a flat triangle list of the same surface would send, without any padding
+    int32 NumUploads = 0;
+    int32 NumRecreated = 0;
+    for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+    {
+        Solver.Step(BenchmarkDeltaTime);
+
+        if (IncrementalMesher.Update(Solver.Positions))
+        {
+            SurfaceSection.Upload(*SurfaceComponent, 0, IncrementalMesher);
+            UploadMs += SurfaceSection.GetStats().Ms;
+            UploadBytes += SurfaceSection.GetStats().Bytes;
+            UnindexedBytes += (int64)IncrementalMesher.GetTriangles().Num() * 2 * sizeof(FVector3f);
+            NumRecreated += SurfaceSection.GetStats().bRecreated ? 1 : 0;
+            ++NumUploads;
+        }
+        IncrementalMs += IncrementalMesher.GetStats().Ms;
+        DirtyBlocks += IncrementalMesher.GetStats().NumDirtyBlocks;
+        TotalBlocks += IncrementalMesher.GetStats().NumBlocks;
+
+        FullMesher.Reset();
+        FullMesher.Update(Solver.Positions);
+        FullMs += FullMesher.GetStats().Ms;
+    }
+
+    const FFluidSurfaceMesherStats &Stats = IncrementalMesher.GetStats();
+    UE_LOG(LogTemp, Display, TEXT("Surface mesher: %d particles, %d frames, cell size %.1f"), Solver.NumOwned, NumSteps, CellSize);
+    UE_LOG(LogTemp, Display, TEXT("  Full rebuild: %.3f ms/frame"), FullMs / FMath::Max(1, NumSteps));
+    UE_LOG(LogTemp, Display, TEXT("  Incremental:  %.3f ms/frame, %.1f%% of blocks re-meshed"), IncrementalMs / FMath::Max(1, NumSteps), DirtyBlocks * 100.0 / FMath::Max<int64>(1, TotalBlocks));
+    UE_LOG(LogTemp, Display, TEXT("  Last frame: %d triangles, %d vertices, %d blocks"), Stats.NumTriangles, Stats.NumVertices, Stats.NumBlocks);
+    UE_LOG(LogTemp, Display, TEXT("  Upload: %.3f ms/frame on the game thread, %d of %d frames uploaded, %d recreated the section"),
+        UploadMs / FMath::Max(1, NumSteps), NumUploads, NumSteps, NumRecreated);
+    UE_LOG(LogTemp, Display, TEXT("  Upload bytes: %.1f KB/frame indexed, %.1f KB/frame as a flat triangle list"),
+        UploadBytes / 1024.0 / FMath::Max(1, NumSteps), UnindexedBytes / 1024.0 / FMath::Max(1, NumSteps));
+}
+
+int32 UFluidBenchmarkCommandlet::RunHaloFailureCheck(const FString &Params)
+{
+#if PLATFORM_LINUX
+    // Rank 0 of two, connected to a rank 1 that is gone before the first exchange
+    int Fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, Fds) != 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("UFluidBenchmarkCommandlet: socketpair failed (errno %d)."), errno);
+        return 1;
+    }
+    close(Fds[1]);
+
+    TUniquePtr<IFluidHaloTransport> Transport = IFluidHaloTransport::CreateFromConnectedSockets(0, 2, { { 1, Fds[0] } });
+    if (!Transport.IsValid())
+    {
+        return 1;
+    }
+
+    FFluidDomainDecomposition Decomposition(2, 0, MoveTemp(Transport));
+    double ElapsedTime = TimeDecomposedSteps(Decomposition, MakeBenchmarkParams(200.0f), FIntVector(6), 1);
+    bool bSecondStepFailed = !Decomposition.Step(BenchmarkDeltaTime); // A failed decomposition must stay failed
+
+    if (ElapsedTime >= 0.0 || !bSecondStepFailed)
+    {
+        UE_LOG(LogTemp, Error, TEXT("Halo failure check: FAILED, stepping against a closed peer socket was not reported."));
+        return 1;
+    }
+    UE_LOG(LogTemp, Display, TEXT("Halo failure check: passed, the closed peer socket was reported as a failed step."));
+    return 0;
+#else
+    UE_LOG(LogTemp, Warning, TEXT("Halo failure check: skipped, it needs the Unix socket transport, which is only available on Linux."));
+    return 0;
+#endif
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FluidBenchmarkCommandlet.generated.h"
+
+// Headless fluid solver benchmarks; no world or AParticle actors are created. Run with:
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=scaling [-ranks=8] [-steps=20] [-transport=unixsocket]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=multiprocess [-ranks=4] [-steps=20]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=precision [-steps=120] [-particlesperaxis=10]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=async [-steps=120] [-renderms=8]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=pressure [-seconds=2] [-basedt=0.004]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=modules [-steps=60]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=colliders [-repeats=200] [-cellsize=5]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=surface [-steps=120] [-cellsize=8]
+//   UnrealEditor-Cmd Fluid_Simulation.uproject -run=FluidBenchmark -mode=halofailure
+UCLASS()
+class UFluidBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UFluidBenchmarkCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+
+private:
+	// Strong and weak scaling of FFluidDomainDecomposition; logs particle-steps per second versus rank count
+	void RunScalingBenchmark(const FString &Params);
+
+	// Strong scaling with one rank per process; launches this commandlet in rank mode once per rank and collects the results
+	void RunMultiProcessBenchmark(const FString &Params);
+
+	// Entry point of one rank process (-mode=rank -rank=N -ranks=M -socketdir=...); returns the process exit code
+	int32 RunRankProcess(const FString &Params);
+
+	// Compares the compact neighbor state against the full-precision path over a sweep of smoothing radii, with force
+	// modules off and on; logs the fp16 density round trip error, drift, timing, resident bytes per particle and neighbor
+	// bytes per pair
+	void RunPrecisionBenchmark(const FString &Params);
+
+	// Compares frame time of the synchronous solver against FFluidAsyncSimulation with simulated game thread work
+	void RunAsyncBenchmark(const FString &Params);
+
+	// Steps the equation of state and the implicit pressure solver at growing time steps; logs stability and density error
+	void RunPressureBenchmark(const FString &Params);
+
+	// Steps with and without the built-in force modules; logs the step time and the time spent in each module
+	void RunForceModuleBenchmark(const FString &Params);
+
+	// Bakes a sphere obstacle, times cache misses and hits, and compares collision cost per particle with and without it
+	void RunColliderBenchmark(const FString &Params);
+
+	// Meshes the fluid surface every step, incrementally and from scratch; logs ms/frame, re-meshed blocks, triangles
+	// and the cost of uploading the incremental mesh to a procedural mesh section
+	void RunSurfaceBenchmark(const FString &Params);
+
+	// Steps a rank whose neighbour's socket was closed and checks that the failed receive is reported; returns the
+	// process exit code, non-zero if the failure went unnoticed
+	int32 RunHaloFailureCheck(const FString &Params);
+};
@@ -0,0 +1,45 @@
+#include "FluidCompactState.h"
+
+void FFluidCompactParticleState::PackPositions(const TArray<FVector> &Positions, const FVector &InOrigin)
+{
+    Origin = InOrigin;
+    PositionsX.SetNumUninitialized(Positions.Num(), EAllowShrinking::No);
+    PositionsY.SetNumUninitialized(Positions.Num(), EAllowShrinking::No);
+    PositionsZ.SetNumUninitialized(Positions.Num(), EAllowShrinking::No);
+
+    for (int32 Index = 0; Index < Positions.Num(); ++Index)
+    {
+        // Subtract in double precision first so large world offsets do not eat the float mantissa
+        FVector Relative = Positions[Index] - Origin;
+        PositionsX[Index] = (float)Relative.X;
+        PositionsY[Index] = (float)Relative.Y;
+        PositionsZ[Index] = (float)Relative.Z;
+    }
+}
+
+void FFluidCompactParticleState::PackDensities(const TArray<float> &InDensities, float InDensityScale)
+{
+    // Raw kernel densities shrink with the radius squared and drop into fp16 subnormals (below 6e-5) for large radii
+    DensityScale = InDensityScale > 0.0f ? InDensityScale : 1.0f;
+    const float InverseScale = 1.0f / DensityScale;
+    Densities.SetNumUninitialized(InDensities.Num(), EAllowShrinking::No);
+
+    for (int32 Index = 0; Index < InDensities.Num(); ++Index)
+    {
+        Densities[Index] = FFloat16(InDensities[Index] * InverseScale);
+    }
+}
+
+void FFluidCompactParticleState::PackVelocities(const TArray<FVector> &Velocities)
+{
+    VelocitiesX.SetNumUninitialized(Velocities.Num(), EAllowShrinking::No);
+    VelocitiesY.SetNumUninitialized(Velocities.Num(), EAllowShrinking::No);
+    VelocitiesZ.SetNumUninitialized(Velocities.Num(), EAllowShrinking::No);
+
+    for (int32 Index = 0; Index < Velocities.Num(); ++Index)
+    {
+        VelocitiesX[Index] = (float)Velocities[Index].X;
+        VelocitiesY[Index] = (float)Velocities[Index].Y;
+        VelocitiesZ[Index] = (float)Velocities[Index].Z;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/Float16.h"
+
+// Compact copy of the particle state read by the neighbor passes (density and pressure). Those passes read every
+// other particle for every particle, so they are bound by memory bandwidth rather than math; this layout halves
+// the bytes read per neighbor compared to the double-precision FVector state.
+//
+// Positions are float32 structure-of-arrays relative to Origin (the prism center) so they keep full float precision
+// regardless of where the prism sits in the world. Densities are fp16 multiples of DensityScale, so their magnitude
+// stays near 1 whatever the kernel radius; all sums are still accumulated in float32.
+// Velocities are only read by force modules, so they are packed (as float32, which loses nothing that matters at
+// simulation speeds) only on steps where a module is active.
+struct FFluidCompactParticleState
+{
+	FVector Origin = FVector::ZeroVector;
+
+	TArray<float> PositionsX;
+	TArray<float> PositionsY;
+	TArray<float> PositionsZ;
+	TArray<FFloat16> Densities; // Divided by DensityScale; read through GetDensity
+	float DensityScale = 1.0f;
+	TArray<float> VelocitiesX;
+	TArray<float> VelocitiesY;
+	TArray<float> VelocitiesZ;
+
+	int32 Num() const { return PositionsX.Num(); }
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return PositionsX.GetAllocatedSize() + PositionsY.GetAllocatedSize() + PositionsZ.GetAllocatedSize() + Densities.GetAllocatedSize() +
+			VelocitiesX.GetAllocatedSize() + VelocitiesY.GetAllocatedSize() + VelocitiesZ.GetAllocatedSize();
+	}
+
+	FVector3f GetPosition(int32 Index) const { return FVector3f(PositionsX[Index], PositionsY[Index], PositionsZ[Index]); }
+
+	float GetDensity(int32 Index) const { return Densities[Index].GetFloat() * DensityScale; }
+
+	FVector3f GetVelocity(int32 Index) const { return FVector3f(VelocitiesX[Index], VelocitiesY[Index], VelocitiesZ[Index]); }
+
+	void PackPositions(const TArray<FVector> &Positions, const FVector &InOrigin); // Convert positions to origin-relative float32
+
+	void PackDensities(const TArray<float> &InDensities, float InDensityScale); // Convert densities to fp16 multiples of InDensityScale
+
+	void PackVelocities(const TArray<FVector> &Velocities); // Convert velocities to float32
+};
@@ -0,0 +1,443 @@
+#include "FluidDomainDecomposition.h"
+
+#include "Async/ParallelFor.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+FFluidDomainDecomposition::FFluidDomainDecomposition(int32 InNumRanks, EFluidHaloTransportType TransportType)
+{
+    int32 NumRanks = FMath::Max(1, InNumRanks);
+    Transport = IFluidHaloTransport::Create(TransportType, NumRanks);
+    Ranks.SetNum(NumRanks);
+    for (int32 Rank = 0; Rank < NumRanks; ++Rank)
+    {
+        LocalRanks.Add(Rank);
+    }
+}
+
+FFluidDomainDecomposition::FFluidDomainDecomposition(int32 InNumRanks, int32 LocalRank, TUniquePtr<IFluidHaloTransport> InTransport)
+    : Transport(MoveTemp(InTransport))
+{
+    check(Transport.IsValid() && Transport->GetNumRanks() == InNumRanks);
+    check(LocalRank >= 0 && LocalRank < InNumRanks);
+    Ranks.SetNum(InNumRanks);
+    LocalRanks.Add(LocalRank);
+}
+
+int32 FFluidDomainDecomposition::GetMaxRanks(const FFluidSolverParams &Params)
+{
+    if (Params.SmoothingRadius <= KINDA_SMALL_NUMBER)
+    {
+        return 1;
+    }
+    return FMath::Max(1, FMath::FloorToInt(2.0f * Params.BoxExtent.X / Params.SmoothingRadius));
+}
+
+int64 FFluidDomainDecomposition::GetBytesExchangedLastStep() const
+{
+    int64 Bytes = 0;
+    for (const FRank &Rank : Ranks)
+    {
+        Bytes += Rank.BytesSent;
+    }
+    return Bytes;
+}
+
+int64 FFluidDomainDecomposition::GetNeighborPairTestsLastStep() const
+{
+    // Neighbor search is all-pairs per rank: both passes test every owned particle against every owned particle and ghost
+    int64 PairTests = 0;
+    for (int32 RankIndex : LocalRanks)
+    {
+        const FFluidSolver &Solver = Ranks[RankIndex].Solver;
+        PairTests += 2 * (int64)Solver.NumOwned * Solver.Num();
+    }
+    return PairTests;
+}
+
+TArray<FFluidForceModuleStats> FFluidDomainDecomposition::GetForceModuleStats() const
+{
+    TArray<FFluidForceModuleStats> Stats;
+    for (const FRank &Rank : Ranks)
+    {
+        for (const FFluidForceModuleStats &RankStats : Rank.Solver.ForceModuleStats)
+        {
+            FFluidForceModuleStats *Existing = Stats.FindByPredicate([&](const FFluidForceModuleStats &Entry) { return Entry.Name == RankStats.Name; });
+            if (Existing)
+            {
+                Existing->Ms += RankStats.Ms;
+            }
+            else
+            {
+                Stats.Add(RankStats);
+            }
+        }
+    }
+    return Stats;
+}
+
+void FFluidDomainDecomposition::Initialize(const FFluidSolverParams &InParams, const TArray<FVector> &Positions, const TArray<FVector> &Velocities)
+{
+    check(Positions.Num() == Velocities.Num());
+    ensureMsgf(GetNumRanks() <= GetMaxRanks(InParams), TEXT("Slabs are narrower than the smoothing radius; halos will miss neighbours."));
+
+    NumParticles = Positions.Num();
+    for (FRank &Rank : Ranks)
+    {
+        Rank.Solver.Reset();
+        Rank.ParticleIds.Empty();
+    }
+    SetParams(InParams);
+
+    for (int32 Index = 0; Index < NumParticles; ++Index)
+    {
+        int32 Slab = GetSlabIndex(Positions[Index].X);
+        if (!LocalRanks.Contains(Slab))
+        {
+            continue; // Owned by another process
+        }
+        FRank &Rank = Ranks[Slab];
+        Rank.Solver.AddParticle(Positions[Index], Velocities[Index]);
+        Rank.ParticleIds.Add(Index);
+    }
+}
+
+void FFluidDomainDecomposition::SetParams(const FFluidSolverParams &InParams)
+{
+    // The implicit solver would need a ghost pressure exchange every iteration, which the ranks do not have
+    checkf(InParams.PressureSolver == EFluidPressureSolver::EquationOfState, TEXT("Domain decomposition only supports the equation of state pressure solver."));
+
+    // Every rank collides against the full box; slab boundaries only decide ownership
+    Params = InParams;
+    for (FRank &Rank : Ranks)
+    {
+        Rank.Solver.Params = Params;
+    }
+}
+
+void FFluidDomainDecomposition::SetForceModules(const TArray<TSharedRef<IFluidForceModule>> &Modules)
+{
+    // Ghosts carry velocities and densities, so velocity dependent modules see across slab boundaries too
+    for (FRank &Rank : Ranks)
+    {
+        Rank.Solver.SetForceModules(Modules);
+    }
+}
+
+bool FFluidDomainDecomposition::Step(float DeltaTime)
+{
+    if (bExchangeFailed)
+    {
+        return false; // Mailboxes may still hold messages of the failed step
+    }
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            Rank.BytesSent = 0;
+            Rank.Solver.ClearGhosts();
+            Rank.Solver.ApplyGravity(DeltaTime);
+        });
+
+    MigrateParticles();
+    if (bExchangeFailed)
+    {
+        return false;
+    }
+    ExchangeGhostParticles();
+    if (bExchangeFailed)
+    {
+        return false;
+    }
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            Ranks[RankIndex].Solver.CalculateDensities();
+        });
+
+    ExchangeGhostDensities();
+    if (bExchangeFailed)
+    {
+        return false;
+    }
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FFluidSolver &Solver = Ranks[RankIndex].Solver;
+            Solver.ApplyPressureForces(DeltaTime);
+            Solver.ResolveBoundingBoxCollisions(DeltaTime);
+        });
+    return true;
+}
+
+void FFluidDomainDecomposition::GatherParticles(TArray<FVector> &OutPositions, TArray<FVector> &OutVelocities) const
+{
+    OutPositions.SetNum(NumParticles);
+    OutVelocities.SetNum(NumParticles);
+
+    for (const FRank &Rank : Ranks)
+    {
+        for (int32 Index = 0; Index < Rank.Solver.NumOwned; ++Index)
+        {
+            OutPositions[Rank.ParticleIds[Index]] = Rank.Solver.Positions[Index];
+            OutVelocities[Rank.ParticleIds[Index]] = Rank.Solver.Velocities[Index];
+        }
+    }
+}
+
+float FFluidDomainDecomposition::GetSlabMinX(int32 Rank) const
+{
+    float SlabWidth = 2.0f * Params.BoxExtent.X / Ranks.Num();
+    return Params.BoxCenter.X - Params.BoxExtent.X + Rank * SlabWidth;
+}
+
+int32 FFluidDomainDecomposition::GetSlabIndex(float X) const
+{
+    float SlabWidth = 2.0f * Params.BoxExtent.X / Ranks.Num();
+    if (SlabWidth <= KINDA_SMALL_NUMBER)
+    {
+        return 0;
+    }
+    int32 Slab = FMath::FloorToInt((X - (Params.BoxCenter.X - Params.BoxExtent.X)) / SlabWidth);
+    return FMath::Clamp(Slab, 0, Ranks.Num() - 1);
+}
+
+int32 FFluidDomainDecomposition::GetNeighbor(int32 Rank, ESide Side) const
+{
+    int32 Neighbor = (Side == Left) ? Rank - 1 : Rank + 1;
+    return Ranks.IsValidIndex(Neighbor) ? Neighbor : INDEX_NONE;
+}
+
+void FFluidDomainDecomposition::SendToNeighbor(int32 Rank, ESide Side, TArray<uint8> &&Payload)
+{
+    Ranks[Rank].BytesSent += Payload.Num();
+    Transport->Send(Rank, GetNeighbor(Rank, Side), MoveTemp(Payload));
+}
+
+bool FFluidDomainDecomposition::ReceiveFromNeighbor(int32 Rank, ESide Side, const TCHAR *Phase, TArray<uint8> &OutPayload)
+{
+    if (Transport->Receive(Rank, GetNeighbor(Rank, Side), OutPayload))
+    {
+        return true;
+    }
+    ReportExchangeFailure(Rank, Side, Phase, TEXT("receive failed"));
+    return false;
+}
+
+void FFluidDomainDecomposition::ReportExchangeFailure(int32 Rank, ESide Side, const TCHAR *Phase, const TCHAR *Reason)
+{
+    UE_LOG(LogTemp, Error, TEXT("FFluidDomainDecomposition: %s: rank %d, %s neighbour (rank %d): %s; the decomposition cannot continue."),
+        Phase, Rank, Side == Left ? TEXT("left") : TEXT("right"), GetNeighbor(Rank, Side), Reason);
+    bExchangeFailed = true;
+}
+
+void FFluidDomainDecomposition::MigrateParticles()
+{
+    // Every phase sends in one ParallelFor and receives in the next, so a rank never waits on a neighbour
+    // that has not been scheduled yet
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            TArray<int32> LeavingIds[2];
+            TArray<FVector> LeavingPositions[2];
+            TArray<FVector> LeavingVelocities[2];
+
+            for (int32 Index = Rank.Solver.NumOwned - 1; Index >= 0; --Index)
+            {
+                int32 Slab = GetSlabIndex(Rank.Solver.Positions[Index].X);
+                if (Slab == RankIndex)
+                {
+                    continue;
+                }
+
+                // Particles that crossed more than one slab keep migrating one slab per step
+                ESide Side = (Slab < RankIndex) ? Left : Right;
+                LeavingIds[Side].Add(Rank.ParticleIds[Index]);
+                LeavingPositions[Side].Add(Rank.Solver.Positions[Index]);
+                LeavingVelocities[Side].Add(Rank.Solver.Velocities[Index]);
+
+                Rank.Solver.RemoveParticleAtSwap(Index);
+                Rank.ParticleIds.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+            }
+
+            for (ESide Side : { Left, Right })
+            {
+                if (GetNeighbor(RankIndex, Side) != INDEX_NONE)
+                {
+                    TArray<uint8> Payload;
+                    FMemoryWriter Writer(Payload);
+                    Writer << LeavingIds[Side] << LeavingPositions[Side] << LeavingVelocities[Side];
+                    SendToNeighbor(RankIndex, Side, MoveTemp(Payload));
+                }
+            }
+        });
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            for (ESide Side : { Left, Right })
+            {
+                TArray<uint8> Payload;
+                if (GetNeighbor(RankIndex, Side) == INDEX_NONE)
+                {
+                    continue;
+                }
+                if (!ReceiveFromNeighbor(RankIndex, Side, TEXT("Migration"), Payload))
+                {
+                    return; // Particles leaving the neighbour this way are lost; Step reports the failure
+                }
+
+                TArray<int32> ArrivingIds;
+                TArray<FVector> ArrivingPositions;
+                TArray<FVector> ArrivingVelocities;
+                FMemoryReader Reader(Payload);
+                Reader << ArrivingIds << ArrivingPositions << ArrivingVelocities;
+
+                for (int32 Index = 0; Index < ArrivingIds.Num(); ++Index)
+                {
+                    Rank.Solver.AddParticle(ArrivingPositions[Index], ArrivingVelocities[Index]);
+                    Rank.ParticleIds.Add(ArrivingIds[Index]);
+                }
+            }
+        });
+}
+
+void FFluidDomainDecomposition::ExchangeGhostParticles()
+{
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            float SlabWidth = 2.0f * Params.BoxExtent.X / Ranks.Num();
+            float HaloBounds[2] = {
+                GetSlabMinX(RankIndex) + Params.SmoothingRadius, // Particles left of this go to the left neighbour
+                GetSlabMinX(RankIndex) + SlabWidth - Params.SmoothingRadius // Particles right of this go to the right neighbour
+            };
+
+            for (ESide Side : { Left, Right })
+            {
+                Rank.HaloIndices[Side].Reset();
+                if (GetNeighbor(RankIndex, Side) == INDEX_NONE)
+                {
+                    continue;
+                }
+
+                TArray<FVector> HaloPositions;
+                TArray<FVector> HaloVelocities;
+                for (int32 Index = 0; Index < Rank.Solver.NumOwned; ++Index)
+                {
+                    float X = Rank.Solver.Positions[Index].X;
+                    if ((Side == Left && X < HaloBounds[Left]) || (Side == Right && X >= HaloBounds[Right]))
+                    {
+                        Rank.HaloIndices[Side].Add(Index);
+                        HaloPositions.Add(Rank.Solver.Positions[Index]);
+                        HaloVelocities.Add(Rank.Solver.Velocities[Index]);
+                    }
+                }
+
+                TArray<uint8> Payload;
+                FMemoryWriter Writer(Payload);
+                Writer << HaloPositions << HaloVelocities;
+                SendToNeighbor(RankIndex, Side, MoveTemp(Payload));
+            }
+        });
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            TArray<FVector> GhostPositions;
+            TArray<FVector> GhostVelocities;
+
+            // Ghosts are stored left neighbour first, then right neighbour; the density exchange relies on this order
+            for (ESide Side : { Left, Right })
+            {
+                Rank.NumGhosts[Side] = 0;
+                TArray<uint8> Payload;
+                if (GetNeighbor(RankIndex, Side) == INDEX_NONE)
+                {
+                    continue;
+                }
+                if (!ReceiveFromNeighbor(RankIndex, Side, TEXT("Ghost exchange"), Payload))
+                {
+                    return;
+                }
+
+                TArray<FVector> HaloPositions;
+                TArray<FVector> HaloVelocities;
+                FMemoryReader Reader(Payload);
+                Reader << HaloPositions << HaloVelocities;
+
+                Rank.NumGhosts[Side] = HaloPositions.Num();
+                GhostPositions.Append(HaloPositions);
+                GhostVelocities.Append(HaloVelocities);
+            }
+
+            Rank.Solver.SetGhosts(GhostPositions, GhostVelocities);
+        });
+}
+
+void FFluidDomainDecomposition::ExchangeGhostDensities()
+{
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            for (ESide Side : { Left, Right })
+            {
+                if (GetNeighbor(RankIndex, Side) == INDEX_NONE)
+                {
+                    continue;
+                }
+
+                TArray<float> HaloDensities;
+                HaloDensities.Reserve(Rank.HaloIndices[Side].Num());
+                for (int32 Index : Rank.HaloIndices[Side])
+                {
+                    HaloDensities.Add(Rank.Solver.DensitiesAroundParticle[Index]);
+                }
+
+                TArray<uint8> Payload;
+                FMemoryWriter Writer(Payload);
+                Writer << HaloDensities;
+                SendToNeighbor(RankIndex, Side, MoveTemp(Payload));
+            }
+        });
+
+    ParallelFor(LocalRanks.Num(), [&](int32 LocalIndex)
+        {
+            const int32 RankIndex = LocalRanks[LocalIndex];
+            FRank &Rank = Ranks[RankIndex];
+            int32 GhostStart = Rank.Solver.NumOwned;
+
+            for (ESide Side : { Left, Right })
+            {
+                TArray<uint8> Payload;
+                if (GetNeighbor(RankIndex, Side) == INDEX_NONE)
+                {
+                    continue;
+                }
+                if (!ReceiveFromNeighbor(RankIndex, Side, TEXT("Density exchange"), Payload))
+                {
+                    return;
+                }
+
+                TArray<float> HaloDensities;
+                FMemoryReader Reader(Payload);
+                Reader << HaloDensities;
+
+                if (Reader.IsError() || HaloDensities.Num() != Rank.NumGhosts[Side])
+                {
+                    ReportExchangeFailure(RankIndex, Side, TEXT("Density exchange"), TEXT("density count does not match the ghosts received"));
+                    return;
+                }
+                FMemory::Memcpy(Rank.Solver.DensitiesAroundParticle.GetData() + GhostStart, HaloDensities.GetData(), HaloDensities.Num() * sizeof(float));
+                GhostStart += Rank.NumGhosts[Side];
+            }
+        });
+}
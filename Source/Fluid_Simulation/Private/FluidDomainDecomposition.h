@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FluidHaloTransport.h"
+#include "FluidSolver.h"
+#include <atomic>
+
+// Splits the bounding box into slabs along X and steps each slab as an independent rank. Every step, particles
+// that left their slab migrate to the neighbouring rank, and particles within SmoothingRadius of a slab boundary
+// are sent to the neighbour as ghosts so density and pressure see the full neighbourhood.
+//
+// Ranks only talk to the slab directly to their left and right, so each slab must be at least SmoothingRadius wide
+// (see GetMaxRanks). All communication goes through an IFluidHaloTransport, so ranks can either all be stepped as
+// parallel tasks of one process, or run one per process (see the FluidBenchmark commandlet's multiprocess mode).
+class FFluidDomainDecomposition
+{
+public:
+	FFluidDomainDecomposition(int32 InNumRanks, EFluidHaloTransportType TransportType); // Every rank in this process
+
+	// Only LocalRank is stepped here; the other ranks run in their own processes and are reached through InTransport
+	FFluidDomainDecomposition(int32 InNumRanks, int32 LocalRank, TUniquePtr<IFluidHaloTransport> InTransport);
+
+	static int32 GetMaxRanks(const FFluidSolverParams &Params); // Largest rank count that keeps slabs wider than SmoothingRadius
+
+	int32 GetNumRanks() const { return Ranks.Num(); }
+
+	int32 GetNumParticles() const { return NumParticles; } // Across all ranks, including those in other processes
+
+	int32 GetNumOwned(int32 Rank) const { return Ranks[Rank].Solver.NumOwned; }
+
+	int32 GetNumGhosts(int32 Rank) const { return Ranks[Rank].Solver.Num() - Ranks[Rank].Solver.NumOwned; }
+
+	int64 GetBytesExchangedLastStep() const; // Total payload bytes sent by this process's ranks during the last Step
+
+	int64 GetNeighborPairTestsLastStep() const; // Distance tests of the density and pressure passes of this process's ranks during the last Step
+
+	TArray<FFluidForceModuleStats> GetForceModuleStats() const; // Force module time of the last Step, summed over all ranks
+
+	void Initialize(const FFluidSolverParams &InParams, const TArray<FVector> &Positions, const TArray<FVector> &Velocities); // Distribute particles to their slabs
+
+	void SetParams(const FFluidSolverParams &InParams); // Apply parameter changes to every rank; the pressure solver must be the equation of state
+
+	void SetForceModules(const TArray<TSharedRef<IFluidForceModule>> &Modules); // Evaluate the same force modules on every rank
+
+	// Advance every rank by one step, exchanging halos in between passes. Returns false if a message from a neighbour
+	// could not be received (peer process gone, socket error, timeout); the error is logged with the rank and side,
+	// the step is abandoned part way and the decomposition must be discarded.
+	bool Step(float DeltaTime);
+
+	// Copy particle state back in the original particle order; only particles owned by this process's ranks are written
+	void GatherParticles(TArray<FVector> &OutPositions, TArray<FVector> &OutVelocities) const;
+
+private:
+	enum ESide { Left = 0, Right = 1 };
+
+	struct FRank
+	{
+		FFluidSolver Solver;
+		TArray<int32> ParticleIds; // Original index of each owned particle, parallel to the solver's owned arrays
+		TArray<int32> HaloIndices[2]; // Owned particles sent as ghosts to the left and right neighbours this step
+		int32 NumGhosts[2] = { 0, 0 }; // Ghosts received from the left and right neighbours this step
+		int64 BytesSent = 0;
+	};
+
+	FFluidSolverParams Params;
+	TUniquePtr<IFluidHaloTransport> Transport;
+	TArray<FRank> Ranks; // Ranks not stepped by this process stay empty
+	TArray<int32> LocalRanks; // Ranks stepped by this process
+	int32 NumParticles = 0;
+	std::atomic<bool> bExchangeFailed = false; // Set by any rank whose receive failed; every later Step fails too
+
+	float GetSlabMinX(int32 Rank) const; // Lower X bound of a rank's slab
+
+	int32 GetSlabIndex(float X) const; // Rank owning the slab that contains X
+
+	int32 GetNeighbor(int32 Rank, ESide Side) const; // Neighbouring rank on the given side, or INDEX_NONE at the box walls
+
+	void SendToNeighbor(int32 Rank, ESide Side, TArray<uint8> &&Payload);
+
+	bool ReceiveFromNeighbor(int32 Rank, ESide Side, const TCHAR *Phase, TArray<uint8> &OutPayload); // Reports the failure if the receive fails
+
+	void ReportExchangeFailure(int32 Rank, ESide Side, const TCHAR *Phase, const TCHAR *Reason);
+
+	void MigrateParticles(); // Hand particles that left their slab to the neighbouring rank
+
+	void ExchangeGhostParticles(); // Send positions and velocities of particles near slab boundaries to the neighbours
+
+	void ExchangeGhostDensities(); // Send densities of the previously exchanged ghosts so pressure can use them
+};
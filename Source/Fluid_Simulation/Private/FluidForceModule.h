@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FFluidSolver;
+struct FFluidSolverParams;
+
+// One particle pair visited by the fused neighbor loop; only pairs within SmoothingRadius are visited
+struct FFluidParticlePair
+{
+	int32 ParticleIndex = INDEX_NONE;
+	int32 NeighborIndex = INDEX_NONE; // May be a ghost owned by another domain decomposition rank
+	FVector Offset = FVector::ZeroVector; // Positions[ParticleIndex] - Positions[NeighborIndex]
+	float Distance = 0.0f;
+	float Kernel = 0.0f; // Smoothing kernel value at Distance
+	FVector KernelGradient = FVector::ZeroVector; // Kernel gradient with respect to the particle's position
+
+	// Read from the same state the pair geometry came from (full precision, or the compact state's float32 velocities
+	// and fp16 neighbor densities), so modules never mix the two; read these rather than the solver's arrays
+	FVector Velocity = FVector::ZeroVector;
+	FVector NeighborVelocity = FVector::ZeroVector;
+	float Density = 0.0f;
+	float NeighborDensity = 0.0f;
+};
+
+// What force modules add to a particle over all of its neighbors
+struct FFluidPairAccumulator
+{
+	FVector Acceleration = FVector::ZeroVector; // Integrated with DeltaTime like the pressure acceleration
+	FVector VelocityCorrection = FVector::ZeroVector; // Added to the velocity as is (XSPH style smoothing)
+};
+
+// Extra particle interaction evaluated inside the solver's pressure neighbor loop, so adding one costs a callback per
+// pair rather than another full pass over all particles. Modules are shared between solver copies and threads, so
+// AccumulatePair must not modify the module; all parameters come from the solver.
+class IFluidForceModule
+{
+public:
+	virtual ~IFluidForceModule() = default;
+
+	virtual FName GetName() const = 0;
+
+	virtual bool IsActive(const FFluidSolverParams &Params) const = 0; // Inactive modules are skipped for the whole pass
+
+	virtual void AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const = 0;
+};
+
+// Time spent in one module during the last step: whole neighbor loops of a sample of the particles are timed with
+// and without the module, and the difference is scaled up to all particles
+struct FFluidForceModuleStats
+{
+	FName Name;
+	float Ms = 0.0f;
+};
@@ -0,0 +1,75 @@
+#include "FluidForceModules.h"
+
+#include "FluidSolver.h"
+
+namespace
+{
+    const float Mass = 1.0f; // Same unit mass the density pass uses
+}
+
+bool FFluidViscosityModule::IsActive(const FFluidSolverParams &Params) const
+{
+    return Params.ArtificialViscosity > 0.0f;
+}
+
+void FFluidViscosityModule::AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const
+{
+    const FFluidSolverParams &Params = Solver.Params;
+
+    // Only approaching pairs are damped
+    FVector RelativeVelocity = Pair.Velocity - Pair.NeighborVelocity;
+    float Approach = FVector::DotProduct(RelativeVelocity, Pair.Offset);
+    if (Approach >= 0.0f)
+    {
+        return;
+    }
+
+    // For the linear equation of state dP/dDensity is PressureFactor, so that sets the speed of sound
+    float SpeedOfSound = FMath::Sqrt(FMath::Max(Params.PressureFactor, 0.0f));
+    float Radius = Params.SmoothingRadius;
+    float Mu = Radius * Approach / (Pair.Distance * Pair.Distance + 0.01f * Radius * Radius);
+    float AverageDensity = 0.5f * (Pair.Density + Pair.NeighborDensity);
+    float Pi = -Params.ArtificialViscosity * SpeedOfSound * Mu / AverageDensity;
+
+    Accumulator.Acceleration -= Mass * Pi * Pair.KernelGradient;
+}
+
+bool FFluidXSPHModule::IsActive(const FFluidSolverParams &Params) const
+{
+    return Params.XSPHFactor > 0.0f;
+}
+
+void FFluidXSPHModule::AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const
+{
+    float AverageDensity = 0.5f * (Pair.Density + Pair.NeighborDensity);
+    FVector VelocityDifference = Pair.NeighborVelocity - Pair.Velocity;
+
+    Accumulator.VelocityCorrection += Solver.Params.XSPHFactor * Mass / AverageDensity * Pair.Kernel * VelocityDifference;
+}
+
+bool FFluidCohesionModule::IsActive(const FFluidSolverParams &Params) const
+{
+    return Params.SurfaceTension > 0.0f;
+}
+
+void FFluidCohesionModule::AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const
+{
+    // Spline from Akinci et al. 2013: repulsive very close, attractive further out, zero at the smoothing radius
+    const double Radius = Solver.Params.SmoothingRadius;
+    const double Distance = Pair.Distance;
+    const double Scale = 32.0 / (PI * FMath::Pow(Radius, 9.0));
+    const double Falloff = (Radius - Distance) * (Radius - Distance) * (Radius - Distance) * Distance * Distance * Distance;
+
+    double Cohesion = (2.0 * Distance > Radius)
+        ? Scale * Falloff
+        : Scale * (2.0 * Falloff - FMath::Pow(Radius, 6.0) / 64.0);
+
+    Accumulator.Acceleration -= Solver.Params.SurfaceTension * Mass * Cohesion * Pair.Offset / Distance;
+}
+
+void RegisterDefaultFluidForceModules(FFluidSolver &Solver)
+{
+    Solver.RegisterForceModule(MakeShared<FFluidViscosityModule>());
+    Solver.RegisterForceModule(MakeShared<FFluidXSPHModule>());
+    Solver.RegisterForceModule(MakeShared<FFluidCohesionModule>());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FluidForceModule.h"
+
+// Monaghan artificial viscosity; damps approaching pairs, strength Params.ArtificialViscosity (alpha)
+class FFluidViscosityModule : public IFluidForceModule
+{
+public:
+	virtual FName GetName() const override { return TEXT("Viscosity"); }
+	virtual bool IsActive(const FFluidSolverParams &Params) const override;
+	virtual void AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const override;
+};
+
+// XSPH velocity smoothing; blends each velocity towards its neighbors' by Params.XSPHFactor (epsilon)
+class FFluidXSPHModule : public IFluidForceModule
+{
+public:
+	virtual FName GetName() const override { return TEXT("XSPH"); }
+	virtual bool IsActive(const FFluidSolverParams &Params) const override;
+	virtual void AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const override;
+};
+
+// Akinci et al. cohesion kernel; pulls particles together at the free surface, strength Params.SurfaceTension
+class FFluidCohesionModule : public IFluidForceModule
+{
+public:
+	virtual FName GetName() const override { return TEXT("Cohesion"); }
+	virtual bool IsActive(const FFluidSolverParams &Params) const override;
+	virtual void AccumulatePair(const FFluidSolver &Solver, const FFluidParticlePair &Pair, FFluidPairAccumulator &Accumulator) const override;
+};
+
+// Registers the built-in modules above; each one stays inactive until its parameter is above zero
+void RegisterDefaultFluidForceModules(FFluidSolver &Solver);
@@ -0,0 +1,421 @@
+#include "FluidHaloTransport.h"
+
+#include "Containers/Queue.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+
+#if PLATFORM_LINUX
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Lock-free queue per directed rank pair; each queue has exactly one producer (FromRank) and one consumer (ToRank).
+// Payloads move between ranks without copies, but every rank must live in this process.
+class FFluidInProcessTransport : public IFluidHaloTransport
+{
+public:
+    FFluidInProcessTransport(int32 InNumRanks, double InReceiveTimeoutSeconds)
+        : NumRanks(InNumRanks)
+        , ReceiveTimeoutSeconds(InReceiveTimeoutSeconds)
+    {
+        for (int32 Index = 0; Index < NumRanks * NumRanks; ++Index)
+        {
+            Mailboxes.Add(MakeUnique<TQueue<TArray<uint8>, EQueueMode::Spsc>>());
+        }
+    }
+
+    virtual int32 GetNumRanks() const override { return NumRanks; }
+
+    virtual void Send(int32 FromRank, int32 ToRank, TArray<uint8> &&Payload) override
+    {
+        Mailboxes[FromRank * NumRanks + ToRank]->Enqueue(MoveTemp(Payload));
+    }
+
+    virtual bool Receive(int32 ToRank, int32 FromRank, TArray<uint8> &OutPayload) override
+    {
+        TQueue<TArray<uint8>, EQueueMode::Spsc> &Mailbox = *Mailboxes[FromRank * NumRanks + ToRank];
+        const double Deadline = FPlatformTime::Seconds() + ReceiveTimeoutSeconds;
+        while (!Mailbox.Dequeue(OutPayload))
+        {
+            if (FPlatformTime::Seconds() > Deadline)
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidInProcessTransport: rank %d got no message from rank %d within %.1f s."), ToRank, FromRank, ReceiveTimeoutSeconds);
+                return false;
+            }
+            FPlatformProcess::Yield();
+        }
+        return true;
+    }
+
+private:
+    int32 NumRanks;
+    double ReceiveTimeoutSeconds;
+    TArray<TUniquePtr<TQueue<TArray<uint8>, EQueueMode::Spsc>>> Mailboxes;
+};
+
+#if PLATFORM_LINUX
+// Length-prefixed frames over non-blocking AF_UNIX stream sockets. Sends that do not fit in the socket buffer are
+// kept pending and flushed by whichever rank is waiting in Receive, so a phase where every rank sends before it
+// receives can never deadlock on a full socket buffer.
+//
+// Links are either anonymous socket pairs between ranks of this process, or named sockets connecting this process's
+// rank to ranks running in other processes.
+class FFluidUnixSocketTransport : public IFluidHaloTransport
+{
+public:
+    FFluidUnixSocketTransport(int32 InNumRanks, double InReceiveTimeoutSeconds)
+        : NumRanks(InNumRanks)
+        , ReceiveTimeoutSeconds(InReceiveTimeoutSeconds)
+    {
+        for (int32 Index = 0; Index < NumRanks * NumRanks; ++Index)
+        {
+            Links.Add(MakeUnique<FLink>());
+        }
+
+        for (int32 RankA = 0; RankA < NumRanks; ++RankA)
+        {
+            for (int32 RankB = RankA + 1; RankB < NumRanks; ++RankB)
+            {
+                int Fds[2];
+                if (socketpair(AF_UNIX, SOCK_STREAM, 0, Fds) != 0)
+                {
+                    UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: socketpair failed for ranks %d and %d (errno %d)."), RankA, RankB, errno);
+                    bValid = false;
+                    continue;
+                }
+                fcntl(Fds[0], F_SETFL, fcntl(Fds[0], F_GETFL) | O_NONBLOCK);
+                fcntl(Fds[1], F_SETFL, fcntl(Fds[1], F_GETFL) | O_NONBLOCK);
+
+                GetLink(RankA, RankB).WriteFd = Fds[0];
+                GetLink(RankB, RankA).ReadFd = Fds[0];
+                GetLink(RankB, RankA).WriteFd = Fds[1];
+                GetLink(RankA, RankB).ReadFd = Fds[1];
+            }
+        }
+    }
+
+    // One rank per process: listen on this rank's socket, connect to every lower rank and accept every higher one.
+    // Lower ranks may not be listening yet, so connecting is retried until the timeout.
+    FFluidUnixSocketTransport(int32 InNumRanks, int32 LocalRank, const FString &SocketDirectory, double TimeoutSeconds, double InReceiveTimeoutSeconds)
+        : NumRanks(InNumRanks)
+        , ReceiveTimeoutSeconds(InReceiveTimeoutSeconds)
+    {
+        for (int32 Index = 0; Index < NumRanks * NumRanks; ++Index)
+        {
+            Links.Add(MakeUnique<FLink>());
+        }
+
+        const double Deadline = FPlatformTime::Seconds() + TimeoutSeconds;
+        IFileManager::Get().MakeDirectory(*SocketDirectory, true);
+
+        sockaddr_un ListenAddress;
+        int ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (!MakeAddress(SocketDirectory, LocalRank, ListenAddress) || ListenFd < 0)
+        {
+            bValid = false;
+            if (ListenFd >= 0)
+            {
+                close(ListenFd);
+            }
+            return;
+        }
+        unlink(ListenAddress.sun_path); // Left over from a previous run that did not shut down cleanly
+        if (bind(ListenFd, reinterpret_cast<sockaddr *>(&ListenAddress), sizeof(ListenAddress)) != 0 || listen(ListenFd, NumRanks) != 0)
+        {
+            UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: rank %d cannot listen on %s (errno %d)."), LocalRank, UTF8_TO_TCHAR(ListenAddress.sun_path), errno);
+            bValid = false;
+            close(ListenFd);
+            return;
+        }
+
+        for (int32 PeerRank = 0; PeerRank < LocalRank && bValid; ++PeerRank)
+        {
+            sockaddr_un PeerAddress;
+            int Fd = -1;
+            while (MakeAddress(SocketDirectory, PeerRank, PeerAddress))
+            {
+                Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (Fd >= 0 && connect(Fd, reinterpret_cast<sockaddr *>(&PeerAddress), sizeof(PeerAddress)) == 0)
+                {
+                    break;
+                }
+                if (Fd >= 0)
+                {
+                    close(Fd);
+                    Fd = -1;
+                }
+                if (FPlatformTime::Seconds() > Deadline)
+                {
+                    break;
+                }
+                FPlatformProcess::Sleep(0.01f);
+            }
+
+            // The first four bytes on every connection tell the accepting rank who is calling
+            int32 Introduction = LocalRank;
+            if (Fd < 0 || send(Fd, &Introduction, sizeof(Introduction), MSG_NOSIGNAL) != sizeof(Introduction))
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: rank %d could not connect to rank %d."), LocalRank, PeerRank);
+                if (Fd >= 0)
+                {
+                    close(Fd);
+                }
+                bValid = false;
+                break;
+            }
+            AddConnectedSocket(LocalRank, PeerRank, Fd);
+        }
+
+        for (int32 NumAccepted = 0; NumAccepted < NumRanks - 1 - LocalRank && bValid; ++NumAccepted)
+        {
+            pollfd ListenPoll = { ListenFd, POLLIN, 0 };
+            int TimeoutMs = FMath::Max(0, (int)((Deadline - FPlatformTime::Seconds()) * 1000.0));
+            int Fd = (poll(&ListenPoll, 1, TimeoutMs) > 0) ? accept(ListenFd, nullptr, nullptr) : -1;
+
+            int32 PeerRank = INDEX_NONE;
+            if (Fd < 0 || recv(Fd, &PeerRank, sizeof(PeerRank), MSG_WAITALL) != sizeof(PeerRank) ||
+                PeerRank <= LocalRank || PeerRank >= NumRanks || GetLink(LocalRank, PeerRank).WriteFd >= 0)
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: rank %d did not get a valid connection from every higher rank."), LocalRank);
+                if (Fd >= 0)
+                {
+                    close(Fd);
+                }
+                bValid = false;
+                break;
+            }
+            AddConnectedSocket(LocalRank, PeerRank, Fd);
+        }
+
+        // Everyone is connected; the name is no longer needed
+        close(ListenFd);
+        unlink(ListenAddress.sun_path);
+    }
+
+    // One rank per process, with sockets some other party already connected to the peers
+    FFluidUnixSocketTransport(int32 InNumRanks, int32 LocalRank, const TMap<int32, int32> &PeerSockets, double InReceiveTimeoutSeconds)
+        : NumRanks(InNumRanks)
+        , ReceiveTimeoutSeconds(InReceiveTimeoutSeconds)
+    {
+        for (int32 Index = 0; Index < NumRanks * NumRanks; ++Index)
+        {
+            Links.Add(MakeUnique<FLink>());
+        }
+
+        for (const TPair<int32, int32> &Peer : PeerSockets)
+        {
+            if (Peer.Key < 0 || Peer.Key >= NumRanks || Peer.Key == LocalRank || Peer.Value < 0)
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: invalid socket %d for peer rank %d of rank %d."), Peer.Value, Peer.Key, LocalRank);
+                bValid = false;
+                continue;
+            }
+            AddConnectedSocket(LocalRank, Peer.Key, Peer.Value);
+        }
+    }
+
+    virtual ~FFluidUnixSocketTransport() override
+    {
+        // Every socket is the write end of exactly one link
+        for (const TUniquePtr<FLink> &Link : Links)
+        {
+            if (Link->WriteFd >= 0)
+            {
+                close(Link->WriteFd);
+            }
+        }
+    }
+
+    bool IsValid() const { return bValid; }
+
+    virtual int32 GetNumRanks() const override { return NumRanks; }
+
+    virtual void Send(int32 FromRank, int32 ToRank, TArray<uint8> &&Payload) override
+    {
+        FLink &Link = GetLink(FromRank, ToRank);
+        FScopeLock Lock(&Link.WriteLock);
+
+        uint32 Length = Payload.Num();
+        Link.PendingWrite.Append(reinterpret_cast<const uint8 *>(&Length), sizeof(Length));
+        Link.PendingWrite.Append(Payload);
+        FlushLink(Link);
+    }
+
+    virtual bool Receive(int32 ToRank, int32 FromRank, TArray<uint8> &OutPayload) override
+    {
+        FLink &Link = GetLink(FromRank, ToRank);
+        const double Deadline = FPlatformTime::Seconds() + ReceiveTimeoutSeconds;
+
+        while (true)
+        {
+            // Only ToRank reads this link, so the read buffer needs no lock
+            if (Link.ReadBuffer.Num() >= (int32)sizeof(uint32))
+            {
+                uint32 Length;
+                FMemory::Memcpy(&Length, Link.ReadBuffer.GetData(), sizeof(Length));
+                int32 FrameSize = sizeof(uint32) + Length;
+                if (Link.ReadBuffer.Num() >= FrameSize)
+                {
+                    OutPayload.SetNumUninitialized(Length);
+                    FMemory::Memcpy(OutPayload.GetData(), Link.ReadBuffer.GetData() + sizeof(uint32), Length);
+                    Link.ReadBuffer.RemoveAt(0, FrameSize, EAllowShrinking::No);
+                    return true;
+                }
+            }
+
+            uint8 Chunk[16 * 1024];
+            ssize_t BytesRead = read(Link.ReadFd, Chunk, sizeof(Chunk));
+            if (BytesRead > 0)
+            {
+                Link.ReadBuffer.Append(Chunk, BytesRead);
+                continue;
+            }
+            if (BytesRead == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: read from rank %d to rank %d failed (errno %d)."), FromRank, ToRank, errno);
+                return false;
+            }
+
+            if (FPlatformTime::Seconds() > Deadline)
+            {
+                UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: rank %d got no message from rank %d within %.1f s."), ToRank, FromRank, ReceiveTimeoutSeconds);
+                return false;
+            }
+
+            // Nothing to read yet; help the senders drain their pending frames before trying again
+            FlushAllLinks();
+            FPlatformProcess::Yield();
+        }
+    }
+
+private:
+    struct FLink
+    {
+        int WriteFd = -1;
+        int ReadFd = -1;
+        FCriticalSection WriteLock;
+        TArray<uint8> PendingWrite; // Bytes accepted by Send that did not fit in the socket buffer yet
+        TArray<uint8> ReadBuffer; // Bytes read from the socket that do not form a complete frame yet
+    };
+
+    FLink &GetLink(int32 FromRank, int32 ToRank) { return *Links[FromRank * NumRanks + ToRank]; }
+
+    // Socket path of a rank in a multi-process run; fails if it does not fit in sun_path
+    static bool MakeAddress(const FString &SocketDirectory, int32 Rank, sockaddr_un &OutAddress)
+    {
+        FTCHARToUTF8 Path(*FPaths::Combine(SocketDirectory, FString::Printf(TEXT("rank%d.sock"), Rank)));
+        FMemory::Memzero(OutAddress);
+        OutAddress.sun_family = AF_UNIX;
+        if (Path.Length() >= (int32)sizeof(OutAddress.sun_path))
+        {
+            UE_LOG(LogTemp, Error, TEXT("FFluidUnixSocketTransport: socket path in %s is too long."), *SocketDirectory);
+            return false;
+        }
+        FMemory::Memcpy(OutAddress.sun_path, Path.Get(), Path.Length());
+        return true;
+    }
+
+    // A connected socket carries both directions between LocalRank and PeerRank
+    void AddConnectedSocket(int32 LocalRank, int32 PeerRank, int Fd)
+    {
+        fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL) | O_NONBLOCK);
+        GetLink(LocalRank, PeerRank).WriteFd = Fd;
+        GetLink(PeerRank, LocalRank).ReadFd = Fd;
+    }
+
+    // Write as much pending data as the socket accepts; caller holds Link.WriteLock
+    static void FlushLink(FLink &Link)
+    {
+        int32 Written = 0;
+        while (Written < Link.PendingWrite.Num())
+        {
+            ssize_t Result = send(Link.WriteFd, Link.PendingWrite.GetData() + Written, Link.PendingWrite.Num() - Written, MSG_NOSIGNAL);
+            if (Result <= 0)
+            {
+                break; // Socket buffer is full (or the peer is gone); retry on the next flush
+            }
+            Written += Result;
+        }
+        Link.PendingWrite.RemoveAt(0, Written, EAllowShrinking::No);
+    }
+
+    void FlushAllLinks()
+    {
+        for (const TUniquePtr<FLink> &Link : Links)
+        {
+            if (Link->WriteFd >= 0 && Link->WriteLock.TryLock())
+            {
+                FlushLink(*Link);
+                Link->WriteLock.Unlock();
+            }
+        }
+    }
+
+    int32 NumRanks;
+    double ReceiveTimeoutSeconds;
+    bool bValid = true;
+    TArray<TUniquePtr<FLink>> Links;
+};
+#endif
+
+TUniquePtr<IFluidHaloTransport> IFluidHaloTransport::Create(EFluidHaloTransportType Type, int32 NumRanks, double ReceiveTimeoutSeconds)
+{
+#if PLATFORM_LINUX
+    if (Type == EFluidHaloTransportType::UnixSocket)
+    {
+        TUniquePtr<FFluidUnixSocketTransport> Transport = MakeUnique<FFluidUnixSocketTransport>(NumRanks, ReceiveTimeoutSeconds);
+        if (Transport->IsValid())
+        {
+            return Transport;
+        }
+        UE_LOG(LogTemp, Warning, TEXT("IFluidHaloTransport: falling back to the in-process transport."));
+    }
+#else
+    if (Type == EFluidHaloTransportType::UnixSocket)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("IFluidHaloTransport: Unix socket transport is only available on Linux, using the in-process transport instead."));
+    }
+#endif
+
+    return MakeUnique<FFluidInProcessTransport>(NumRanks, ReceiveTimeoutSeconds);
+}
+
+TUniquePtr<IFluidHaloTransport> IFluidHaloTransport::CreateForProcess(int32 LocalRank, int32 NumRanks, const FString &SocketDirectory, double TimeoutSeconds,
+    double ReceiveTimeoutSeconds)
+{
+#if PLATFORM_LINUX
+    check(LocalRank >= 0 && LocalRank < NumRanks);
+    TUniquePtr<FFluidUnixSocketTransport> Transport = MakeUnique<FFluidUnixSocketTransport>(NumRanks, LocalRank, SocketDirectory, TimeoutSeconds, ReceiveTimeoutSeconds);
+    if (Transport->IsValid())
+    {
+        return Transport;
+    }
+#else
+    UE_LOG(LogTemp, Error, TEXT("IFluidHaloTransport: multi-process ranks need the Unix socket transport, which is only available on Linux."));
+#endif
+    return nullptr;
+}
+
+TUniquePtr<IFluidHaloTransport> IFluidHaloTransport::CreateFromConnectedSockets(int32 LocalRank, int32 NumRanks, const TMap<int32, int32> &PeerSockets,
+    double ReceiveTimeoutSeconds)
+{
+#if PLATFORM_LINUX
+    check(LocalRank >= 0 && LocalRank < NumRanks);
+    TUniquePtr<FFluidUnixSocketTransport> Transport = MakeUnique<FFluidUnixSocketTransport>(NumRanks, LocalRank, PeerSockets, ReceiveTimeoutSeconds);
+    if (Transport->IsValid())
+    {
+        return Transport;
+    }
+#else
+    UE_LOG(LogTemp, Error, TEXT("IFluidHaloTransport: connected socket transports are only available on Linux."));
+#endif
+    return nullptr;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FluidHaloTransport.generated.h"
+
+// Transport used to move halo and migration payloads between domain decomposition ranks
+UENUM(BlueprintType)
+enum class EFluidHaloTransportType : uint8
+{
+	InProcess UMETA(DisplayName = "In-Process Queue"), // Lock-free queues between ranks of this process; cannot cross processes
+	UnixSocket UMETA(DisplayName = "Unix Socket"), // One AF_UNIX socket pair per rank pair; Linux only
+};
+
+// Point-to-point message transport between ranks. Messages between a given (From, To) pair are delivered in
+// the order they were sent. Send never blocks; Receive blocks until the next message from From has arrived, and
+// fails if none arrives within the transport's receive timeout or the link to From is broken.
+class IFluidHaloTransport
+{
+public:
+	static constexpr double DefaultReceiveTimeoutSeconds = 10.0; // Far above a step; a neighbour this late is hung or gone
+
+	virtual ~IFluidHaloTransport() = default;
+
+	virtual int32 GetNumRanks() const = 0;
+
+	virtual void Send(int32 FromRank, int32 ToRank, TArray<uint8> &&Payload) = 0;
+
+	virtual bool Receive(int32 ToRank, int32 FromRank, TArray<uint8> &OutPayload) = 0;
+
+	// Creates a transport of the requested type for ranks that all live in this process; falls back to in-process
+	// queues where sockets are unavailable
+	static TUniquePtr<IFluidHaloTransport> Create(EFluidHaloTransportType Type, int32 NumRanks, double ReceiveTimeoutSeconds = DefaultReceiveTimeoutSeconds);
+
+	// Creates the transport of one rank in a multi-process run: every rank listens on a named AF_UNIX socket in
+	// SocketDirectory and connects to the others. Blocks until all ranks are connected or TimeoutSeconds pass.
+	// Only Send from and Receive to LocalRank are valid. Returns null on failure or on platforms other than Linux.
+	static TUniquePtr<IFluidHaloTransport> CreateForProcess(int32 LocalRank, int32 NumRanks, const FString &SocketDirectory, double TimeoutSeconds,
+		double ReceiveTimeoutSeconds = DefaultReceiveTimeoutSeconds);
+
+	// Like CreateForProcess, but adopts stream sockets that are already connected to the peers (peer rank -> file
+	// descriptor), e.g. inherited from a launcher. The transport takes ownership of the descriptors. Linux only.
+	static TUniquePtr<IFluidHaloTransport> CreateFromConnectedSockets(int32 LocalRank, int32 NumRanks, const TMap<int32, int32> &PeerSockets,
+		double ReceiveTimeoutSeconds = DefaultReceiveTimeoutSeconds);
+};
@@ -0,0 +1,416 @@
+#include "FluidSignedDistanceField.h"
+
+#include "Async/ParallelFor.h"
+#include "Hash/xxhash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+    // Bump when the bake or the file layout changes so stale cache files are rebaked
+    const int32 SignedDistanceFieldCacheVersion = 3;
+
+    // Inside/outside test for points far from the surface: the generalized winding number, i.e. the solid angle the
+    // mesh subtends at Point over 4 pi (Van Oosterom and Strackee). It is 1 inside a closed mesh and 0 outside, and
+    // unlike a ray parity test it does not care about rays grazing edges or vertices, and degrades gracefully on
+    // meshes with small holes.
+    bool IsInsideMesh(const FVector &Point, const TArray<FVector> &Vertices, const TArray<int32> &Indices)
+    {
+        double SolidAngle = 0.0;
+        for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+        {
+            const FVector A = Vertices[Indices[Index]] - Point;
+            const FVector B = Vertices[Indices[Index + 1]] - Point;
+            const FVector C = Vertices[Indices[Index + 2]] - Point;
+            const double LengthA = A.Size();
+            const double LengthB = B.Size();
+            const double LengthC = C.Size();
+
+            const double Numerator = FVector::DotProduct(A, FVector::CrossProduct(B, C));
+            const double Denominator = LengthA * LengthB * LengthC + FVector::DotProduct(A, B) * LengthC + FVector::DotProduct(B, C) * LengthA + FVector::DotProduct(C, A) * LengthB;
+            SolidAngle += 2.0 * FMath::Atan2(Numerator, Denominator);
+        }
+        return SolidAngle / (4.0 * UE_DOUBLE_PI) > 0.5;
+    }
+
+    // Angle-weighted pseudo-normals (Baerentzen and Aanaes): the sign of Point - Closest against the pseudo-normal of
+    // the feature (face, edge or vertex) the closest point lies on is correct for any closed mesh, including points
+    // nearest to a sharp edge or corner, where a single face normal can point the wrong way.
+    struct FPseudoNormals
+    {
+        TArray<FVector> FaceNormals; // Per triangle
+        TArray<FVector> EdgeNormals; // Per triangle corner k: the edge from corner k to corner k + 1
+        TArray<FVector> VertexNormals; // Per welded vertex
+        TArray<int32> WeldedVertices; // Per index: vertices at the same position share normals across UV and normal seams
+
+        FPseudoNormals(const TArray<FVector> &Vertices, const TArray<int32> &Indices)
+        {
+            const int32 NumTriangles = Indices.Num() / 3;
+            TMap<FVector, int32> WeldedIds;
+            WeldedVertices.SetNumUninitialized(NumTriangles * 3);
+            for (int32 Index = 0; Index < NumTriangles * 3; ++Index)
+            {
+                WeldedVertices[Index] = WeldedIds.FindOrAdd(Vertices[Indices[Index]], WeldedIds.Num());
+            }
+
+            FaceNormals.SetNumUninitialized(NumTriangles);
+            VertexNormals.Init(FVector::ZeroVector, WeldedIds.Num());
+            TMap<TPair<int32, int32>, FVector> EdgeSums;
+            for (int32 Triangle = 0; Triangle < NumTriangles; ++Triangle)
+            {
+                const FVector Corners[3] = { Vertices[Indices[Triangle * 3]], Vertices[Indices[Triangle * 3 + 1]], Vertices[Indices[Triangle * 3 + 2]] };
+                FVector Normal = FVector::CrossProduct(Corners[1] - Corners[0], Corners[2] - Corners[0]).GetSafeNormal();
+                FaceNormals[Triangle] = Normal;
+
+                for (int32 Corner = 0; Corner < 3; ++Corner)
+                {
+                    const FVector ToNext = (Corners[(Corner + 1) % 3] - Corners[Corner]).GetSafeNormal();
+                    const FVector ToPrevious = (Corners[(Corner + 2) % 3] - Corners[Corner]).GetSafeNormal();
+                    const double Angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(ToNext, ToPrevious), -1.0, 1.0));
+                    VertexNormals[WeldedVertices[Triangle * 3 + Corner]] += Angle * Normal;
+                    EdgeSums.FindOrAdd(GetEdgeKey(Triangle, Corner), FVector::ZeroVector) += Normal;
+                }
+            }
+
+            EdgeNormals.SetNumUninitialized(NumTriangles * 3);
+            for (int32 Triangle = 0; Triangle < NumTriangles; ++Triangle)
+            {
+                for (int32 Corner = 0; Corner < 3; ++Corner)
+                {
+                    EdgeNormals[Triangle * 3 + Corner] = EdgeSums[GetEdgeKey(Triangle, Corner)];
+                }
+            }
+        }
+
+        TPair<int32, int32> GetEdgeKey(int32 Triangle, int32 Corner) const
+        {
+            int32 From = WeldedVertices[Triangle * 3 + Corner];
+            int32 To = WeldedVertices[Triangle * 3 + (Corner + 1) % 3];
+            return TPair<int32, int32>(FMath::Min(From, To), FMath::Max(From, To));
+        }
+
+        // Pseudo-normal of the feature of triangle (A, B, C) that Closest lies on
+        FVector Get(int32 Triangle, const FVector &Closest, const FVector &A, const FVector &B, const FVector &C) const
+        {
+            // Barycentric weights near zero say which corners the closest point is away from
+            const double Tolerance = 1e-5;
+            const FVector Weights = FMath::ComputeBaryCentric2D(Closest, A, B, C);
+            const bool bOnCorner[3] = { Weights.X > Tolerance, Weights.Y > Tolerance, Weights.Z > Tolerance };
+            const int32 NumCorners = bOnCorner[0] + bOnCorner[1] + bOnCorner[2];
+
+            if (NumCorners == 1)
+            {
+                const int32 Corner = bOnCorner[0] ? 0 : (bOnCorner[1] ? 1 : 2);
+                return VertexNormals[WeldedVertices[Triangle * 3 + Corner]];
+            }
+            if (NumCorners == 2)
+            {
+                // Edge k joins corners k and k + 1, so it is the edge that leaves out corner k + 2
+                const int32 Corner = !bOnCorner[2] ? 0 : (!bOnCorner[0] ? 1 : 2);
+                return EdgeNormals[Triangle * 3 + Corner];
+            }
+            return FaceNormals[Triangle];
+        }
+    };
+}
+
+TSharedPtr<FFluidSignedDistanceField> FFluidSignedDistanceField::Bake(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth)
+{
+    if (Indices.Num() < 3 || CellSize <= KINDA_SMALL_NUMBER || BandWidth <= KINDA_SMALL_NUMBER)
+    {
+        return nullptr;
+    }
+
+    TSharedPtr<FFluidSignedDistanceField> Field = MakeShared<FFluidSignedDistanceField>();
+    FBox Bounds(Vertices);
+    Bounds = Bounds.ExpandBy(BandWidth + CellSize);
+
+    Field->Origin = Bounds.Min;
+    Field->CellSize = CellSize;
+    Field->BandWidth = BandWidth;
+    FVector Size = Bounds.GetSize();
+    Field->NumVertices = FIntVector(
+        FMath::CeilToInt(Size.X / CellSize) + 1,
+        FMath::CeilToInt(Size.Y / CellSize) + 1,
+        FMath::CeilToInt(Size.Z / CellSize) + 1);
+    Field->NumBricks = FIntVector(
+        FMath::DivideAndRoundUp(Field->NumVertices.X, BrickSize),
+        FMath::DivideAndRoundUp(Field->NumVertices.Y, BrickSize),
+        FMath::DivideAndRoundUp(Field->NumVertices.Z, BrickSize));
+
+    const int32 TotalBricks = Field->NumBricks.X * Field->NumBricks.Y * Field->NumBricks.Z;
+    const FIntVector MaxBrick = Field->NumBricks - FIntVector(1);
+
+    // Bucket every triangle into the bricks within BandWidth of it; those are the only bricks that store samples
+    TArray<TArray<int32>> BrickTriangles;
+    BrickTriangles.SetNum(TotalBricks);
+    for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+    {
+        FBox TriangleBounds(ForceInit);
+        TriangleBounds += Vertices[Indices[Index]];
+        TriangleBounds += Vertices[Indices[Index + 1]];
+        TriangleBounds += Vertices[Indices[Index + 2]];
+        TriangleBounds = TriangleBounds.ExpandBy(BandWidth);
+
+        FVector MinCoord = (TriangleBounds.Min - Field->Origin) / CellSize;
+        FVector MaxCoord = (TriangleBounds.Max - Field->Origin) / CellSize;
+        FIntVector MinBrickCoord(FMath::FloorToInt(MinCoord.X) / BrickSize, FMath::FloorToInt(MinCoord.Y) / BrickSize, FMath::FloorToInt(MinCoord.Z) / BrickSize);
+        FIntVector MaxBrickCoord(FMath::CeilToInt(MaxCoord.X) / BrickSize, FMath::CeilToInt(MaxCoord.Y) / BrickSize, FMath::CeilToInt(MaxCoord.Z) / BrickSize);
+
+        for (int32 BrickZ = FMath::Max(MinBrickCoord.Z, 0); BrickZ <= FMath::Min(MaxBrickCoord.Z, MaxBrick.Z); ++BrickZ)
+        {
+            for (int32 BrickY = FMath::Max(MinBrickCoord.Y, 0); BrickY <= FMath::Min(MaxBrickCoord.Y, MaxBrick.Y); ++BrickY)
+            {
+                for (int32 BrickX = FMath::Max(MinBrickCoord.X, 0); BrickX <= FMath::Min(MaxBrickCoord.X, MaxBrick.X); ++BrickX)
+                {
+                    BrickTriangles[Field->GetBrickIndex(BrickX, BrickY, BrickZ)].Add(Index);
+                }
+            }
+        }
+    }
+
+    const int32 SamplesPerBrick = BrickSize * BrickSize * BrickSize;
+    Field->BrickOffsets.Init(INDEX_NONE, TotalBricks);
+    Field->BrickUniformDistances.Init(BandWidth, TotalBricks);
+    Field->BrickCenterDistances.Init(0.0f, TotalBricks);
+    Field->BrickCenterGradients.Init(FVector3f::ZeroVector, TotalBricks);
+    int32 NumAllocatedBricks = 0;
+    for (int32 BrickIndex = 0; BrickIndex < TotalBricks; ++BrickIndex)
+    {
+        if (BrickTriangles[BrickIndex].Num() > 0)
+        {
+            Field->BrickOffsets[BrickIndex] = NumAllocatedBricks++ * SamplesPerBrick;
+        }
+    }
+    Field->BrickSamples.SetNumUninitialized(NumAllocatedBricks * SamplesPerBrick);
+
+    const FPseudoNormals PseudoNormals(Vertices, Indices);
+    ParallelFor(TotalBricks, [&](int32 BrickIndex)
+        {
+            const int32 BrickX = BrickIndex % Field->NumBricks.X;
+            const int32 BrickY = (BrickIndex / Field->NumBricks.X) % Field->NumBricks.Y;
+            const int32 BrickZ = BrickIndex / (Field->NumBricks.X * Field->NumBricks.Y);
+            const FVector BrickOrigin = Field->Origin + FVector(BrickX, BrickY, BrickZ) * (BrickSize * CellSize);
+            const FVector BrickCenter = Field->GetBrickCenter(BrickX, BrickY, BrickZ);
+
+            // Fallback for the flat region deeper than BandWidth: the nearest point on any triangle, since nothing within
+            // BandWidth of the center is guaranteed to exist. Bricks entirely outside never have such a region.
+            const TArray<int32> &Triangles = BrickTriangles[BrickIndex];
+            const bool bCenterInside = IsInsideMesh(BrickCenter, Vertices, Indices);
+            if (bCenterInside || Triangles.Num() > 0)
+            {
+                double ClosestDistanceSquared = TNumericLimits<double>::Max();
+                FVector ClosestPoint = BrickCenter;
+                for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+                {
+                    FVector Closest = FMath::ClosestPointOnTriangleToPoint(BrickCenter, Vertices[Indices[Index]], Vertices[Indices[Index + 1]], Vertices[Indices[Index + 2]]);
+                    double DistanceSquared = FVector::DistSquared(BrickCenter, Closest);
+                    if (DistanceSquared < ClosestDistanceSquared)
+                    {
+                        ClosestDistanceSquared = DistanceSquared;
+                        ClosestPoint = Closest;
+                    }
+                }
+                const double Sign = bCenterInside ? -1.0 : 1.0;
+                Field->BrickCenterDistances[BrickIndex] = Sign * FMath::Sqrt(ClosestDistanceSquared);
+                Field->BrickCenterGradients[BrickIndex] = FVector3f(Sign * (BrickCenter - ClosestPoint).GetSafeNormal());
+            }
+
+            if (Triangles.Num() == 0)
+            {
+                // Far from every triangle: one inside/outside test for the whole brick
+                Field->BrickUniformDistances[BrickIndex] = bCenterInside ? -BandWidth : BandWidth;
+                return;
+            }
+
+            float *Samples = Field->BrickSamples.GetData() + Field->BrickOffsets[BrickIndex];
+            for (int32 LocalZ = 0; LocalZ < BrickSize; ++LocalZ)
+            {
+                for (int32 LocalY = 0; LocalY < BrickSize; ++LocalY)
+                {
+                    for (int32 LocalX = 0; LocalX < BrickSize; ++LocalX)
+                    {
+                        const FVector Point = BrickOrigin + FVector(LocalX, LocalY, LocalZ) * CellSize;
+                        double ClosestDistanceSquared = TNumericLimits<double>::Max();
+                        double Sign = 1.0;
+
+                        for (int32 TriangleIndex : Triangles)
+                        {
+                            const FVector &A = Vertices[Indices[TriangleIndex]];
+                            const FVector &B = Vertices[Indices[TriangleIndex + 1]];
+                            const FVector &C = Vertices[Indices[TriangleIndex + 2]];
+                            FVector Closest = FMath::ClosestPointOnTriangleToPoint(Point, A, B, C);
+                            double DistanceSquared = FVector::DistSquared(Point, Closest);
+                            if (DistanceSquared < ClosestDistanceSquared)
+                            {
+                                ClosestDistanceSquared = DistanceSquared;
+                                Sign = FVector::DotProduct(Point - Closest, PseudoNormals.Get(TriangleIndex / 3, Closest, A, B, C)) >= 0.0 ? 1.0 : -1.0;
+                            }
+                        }
+
+                        Samples[(LocalZ * BrickSize + LocalY) * BrickSize + LocalX] = Sign * FMath::Min(FMath::Sqrt(ClosestDistanceSquared), (double)BandWidth);
+                    }
+                }
+            }
+        });
+
+    return Field;
+}
+
+TSharedPtr<const FFluidSignedDistanceField> FFluidSignedDistanceField::LoadOrBake(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth, const FString &CacheDirectory)
+{
+    const uint64 Hash = HashMesh(Vertices, Indices, CellSize, BandWidth);
+    const FString CachePath = FPaths::Combine(CacheDirectory, FString::Printf(TEXT("%016llx.sdf"), Hash));
+
+    TArray<uint8> Bytes;
+    if (FFileHelper::LoadFileToArray(Bytes, *CachePath, FILEREAD_Silent))
+    {
+        TSharedPtr<FFluidSignedDistanceField> Field = MakeShared<FFluidSignedDistanceField>();
+        FMemoryReader Reader(Bytes);
+        Reader << *Field;
+        if (!Reader.IsError())
+        {
+            UE_LOG(LogTemp, Log, TEXT("FFluidSignedDistanceField: loaded %s (%d of %d bricks allocated)."), *CachePath, Field->GetNumAllocatedBricks(), Field->GetNumBricks());
+            return Field;
+        }
+        UE_LOG(LogTemp, Warning, TEXT("FFluidSignedDistanceField: %s is stale or corrupt, rebaking."), *CachePath);
+    }
+
+    double StartTime = FPlatformTime::Seconds();
+    TSharedPtr<FFluidSignedDistanceField> Field = Bake(Vertices, Indices, CellSize, BandWidth);
+    if (!Field.IsValid())
+    {
+        return nullptr;
+    }
+    UE_LOG(LogTemp, Log, TEXT("FFluidSignedDistanceField: baked %d triangles in %.1f ms (%d of %d bricks allocated)."),
+        Indices.Num() / 3, (FPlatformTime::Seconds() - StartTime) * 1000.0, Field->GetNumAllocatedBricks(), Field->GetNumBricks());
+
+    TArray<uint8> OutBytes;
+    FMemoryWriter Writer(OutBytes);
+    Writer << *Field;
+    if (!FFileHelper::SaveArrayToFile(OutBytes, *CachePath))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("FFluidSignedDistanceField: could not write cache file %s."), *CachePath);
+    }
+    return Field;
+}
+
+uint64 FFluidSignedDistanceField::HashMesh(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth)
+{
+    FXxHash64Builder Builder;
+    Builder.Update(&SignedDistanceFieldCacheVersion, sizeof(SignedDistanceFieldCacheVersion));
+    Builder.Update(&CellSize, sizeof(CellSize));
+    Builder.Update(&BandWidth, sizeof(BandWidth));
+    Builder.Update(Vertices.GetData(), Vertices.Num() * sizeof(FVector));
+    Builder.Update(Indices.GetData(), Indices.Num() * sizeof(int32));
+    return Builder.Finalize().Hash;
+}
+
+float FFluidSignedDistanceField::Sample(const FVector &Position, FVector &OutGradient) const
+{
+    const FVector Local = (Position - Origin) / CellSize;
+    if (Local.X < 0.0 || Local.Y < 0.0 || Local.Z < 0.0 ||
+        Local.X >= NumVertices.X - 1 || Local.Y >= NumVertices.Y - 1 || Local.Z >= NumVertices.Z - 1)
+    {
+        OutGradient = FVector::ZeroVector;
+        return BandWidth; // Outside the baked bounds nothing is close to an obstacle
+    }
+
+    const int32 X = FMath::FloorToInt(Local.X);
+    const int32 Y = FMath::FloorToInt(Local.Y);
+    const int32 Z = FMath::FloorToInt(Local.Z);
+    const float FX = Local.X - X;
+    const float FY = Local.Y - Y;
+    const float FZ = Local.Z - Z;
+
+    const float D000 = GetVertexDistance(X, Y, Z);
+    const float D100 = GetVertexDistance(X + 1, Y, Z);
+    const float D010 = GetVertexDistance(X, Y + 1, Z);
+    const float D110 = GetVertexDistance(X + 1, Y + 1, Z);
+    const float D001 = GetVertexDistance(X, Y, Z + 1);
+    const float D101 = GetVertexDistance(X + 1, Y, Z + 1);
+    const float D011 = GetVertexDistance(X, Y + 1, Z + 1);
+    const float D111 = GetVertexDistance(X + 1, Y + 1, Z + 1);
+
+    // Derivative of the trilinear interpolant along each axis
+    OutGradient.X = ((D100 - D000) * (1 - FY) * (1 - FZ) + (D110 - D010) * FY * (1 - FZ) + (D101 - D001) * (1 - FY) * FZ + (D111 - D011) * FY * FZ) / CellSize;
+    OutGradient.Y = ((D010 - D000) * (1 - FX) * (1 - FZ) + (D110 - D100) * FX * (1 - FZ) + (D011 - D001) * (1 - FX) * FZ + (D111 - D101) * FX * FZ) / CellSize;
+    OutGradient.Z = ((D001 - D000) * (1 - FX) * (1 - FY) + (D101 - D100) * FX * (1 - FY) + (D011 - D010) * (1 - FX) * FY + (D111 - D110) * FX * FY) / CellSize;
+
+    const float D00 = FMath::Lerp(D000, D100, FX);
+    const float D10 = FMath::Lerp(D010, D110, FX);
+    const float D01 = FMath::Lerp(D001, D101, FX);
+    const float D11 = FMath::Lerp(D011, D111, FX);
+    const float Distance = FMath::Lerp(FMath::Lerp(D00, D10, FY), FMath::Lerp(D01, D11, FY), FZ);
+
+    // All eight corners clamped to -BandWidth: fall back to the distance field linearized at the brick's center
+    if (Distance < 0.0f && OutGradient.IsNearlyZero())
+    {
+        const int32 BrickX = X / BrickSize;
+        const int32 BrickY = Y / BrickSize;
+        const int32 BrickZ = Z / BrickSize;
+        const int32 BrickIndex = GetBrickIndex(BrickX, BrickY, BrickZ);
+        const FVector CenterGradient(BrickCenterGradients[BrickIndex]);
+        if (!CenterGradient.IsZero())
+        {
+            OutGradient = CenterGradient;
+            const float EstimatedDistance = BrickCenterDistances[BrickIndex] + FVector::DotProduct(Position - GetBrickCenter(BrickX, BrickY, BrickZ), CenterGradient);
+            return FMath::Min(EstimatedDistance, Distance); // Still at least BandWidth deep, or the corners would not be clamped
+        }
+    }
+    return Distance;
+}
+
+float FFluidSignedDistanceField::GetVertexDistance(int32 X, int32 Y, int32 Z) const
+{
+    const int32 BrickIndex = GetBrickIndex(X / BrickSize, Y / BrickSize, Z / BrickSize);
+    const int32 Offset = BrickOffsets[BrickIndex];
+    if (Offset == INDEX_NONE)
+    {
+        return BrickUniformDistances[BrickIndex];
+    }
+    return BrickSamples[Offset + ((Z % BrickSize) * BrickSize + (Y % BrickSize)) * BrickSize + (X % BrickSize)];
+}
+
+FArchive &operator<<(FArchive &Ar, FFluidSignedDistanceField &Field)
+{
+    int32 Version = SignedDistanceFieldCacheVersion;
+    Ar << Version;
+    if (Version != SignedDistanceFieldCacheVersion)
+    {
+        Ar.SetError();
+        return Ar;
+    }
+
+    Ar << Field.Origin << Field.CellSize << Field.BandWidth << Field.NumVertices << Field.NumBricks;
+    Ar << Field.BrickOffsets << Field.BrickUniformDistances << Field.BrickSamples << Field.BrickCenterDistances << Field.BrickCenterGradients;
+
+    // A truncated or hand-edited cache must not lead to out of bounds reads in Sample
+    if (Ar.IsLoading() && !Ar.IsError())
+    {
+        const int32 SamplesPerBrick = FFluidSignedDistanceField::BrickSize * FFluidSignedDistanceField::BrickSize * FFluidSignedDistanceField::BrickSize;
+        const FIntVector &NumVertices = Field.NumVertices;
+        const FIntVector &NumBricks = Field.NumBricks;
+        bool bValid = Field.CellSize > 0.0f && NumVertices.GetMin() >= 2 &&
+            NumBricks.X == FMath::DivideAndRoundUp(NumVertices.X, FFluidSignedDistanceField::BrickSize) &&
+            NumBricks.Y == FMath::DivideAndRoundUp(NumVertices.Y, FFluidSignedDistanceField::BrickSize) &&
+            NumBricks.Z == FMath::DivideAndRoundUp(NumVertices.Z, FFluidSignedDistanceField::BrickSize);
+
+        const int64 TotalBricks = (int64)NumBricks.X * NumBricks.Y * NumBricks.Z;
+        bValid = bValid && Field.BrickOffsets.Num() == TotalBricks && Field.BrickUniformDistances.Num() == TotalBricks && Field.BrickSamples.Num() % SamplesPerBrick == 0 &&
+            Field.BrickCenterDistances.Num() == TotalBricks && Field.BrickCenterGradients.Num() == TotalBricks;
+        for (int32 Index = 0; bValid && Index < Field.BrickOffsets.Num(); ++Index)
+        {
+            const int32 Offset = Field.BrickOffsets[Index];
+            bValid = Offset == INDEX_NONE || (Offset >= 0 && Offset % SamplesPerBrick == 0 && Offset + SamplesPerBrick <= Field.BrickSamples.Num());
+        }
+
+        if (!bValid)
+        {
+            Ar.SetError();
+        }
+    }
+    return Ar;
+}
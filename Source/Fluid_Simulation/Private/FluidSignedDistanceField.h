@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Sparse signed distance field of static obstacle geometry; negative inside the obstacles, positive outside.
+//
+// Distances are stored at the vertices of a regular grid split into bricks of BrickSize^3 vertices. Only bricks
+// within BandWidth of a triangle store per-vertex samples; every other brick stores a single +/-BandWidth value, so
+// memory grows with the obstacle surface area rather than its volume. Baking is slow (it is done once at load time)
+// and the result is cached on disk keyed by a hash of the mesh and bake settings.
+//
+// Deeper than BandWidth inside an obstacle every sample is clamped and the field is flat. So that particles which end
+// up there (spawned inside, or moved further than BandWidth in one step) can still be pushed out, every brick that can
+// contain such a region (center inside, or near a triangle) also stores the unclamped distance and gradient at its
+// center, from the nearest point on the whole mesh.
+class FFluidSignedDistanceField
+{
+public:
+	static constexpr int32 BrickSize = 8;
+
+	// Bake from a world-space triangle list. Triangles are expected to be consistently wound with outward normals.
+	static TSharedPtr<FFluidSignedDistanceField> Bake(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth);
+
+	// Load the field for this mesh from CacheDirectory, or bake it and write it there
+	static TSharedPtr<const FFluidSignedDistanceField> LoadOrBake(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth, const FString &CacheDirectory);
+
+	// Hash of the triangles and bake settings; the cache file name
+	static uint64 HashMesh(const TArray<FVector> &Vertices, const TArray<int32> &Indices, float CellSize, float BandWidth);
+
+	// Trilinear distance at Position and its gradient; returns BandWidth outside the baked bounds. Where the field is
+	// flat deep inside an obstacle, returns the distance and direction to the nearest surface estimated from the
+	// brick's center instead, so the gradient is never zero inside.
+	float Sample(const FVector &Position, FVector &OutGradient) const;
+
+	int32 GetNumAllocatedBricks() const { return BrickSamples.Num() / (BrickSize * BrickSize * BrickSize); }
+
+	int32 GetNumBricks() const { return BrickOffsets.Num(); }
+
+	SIZE_T GetAllocatedSize() const
+	{
+		return BrickOffsets.GetAllocatedSize() + BrickUniformDistances.GetAllocatedSize() + BrickSamples.GetAllocatedSize() +
+			BrickCenterDistances.GetAllocatedSize() + BrickCenterGradients.GetAllocatedSize();
+	}
+
+	friend FArchive &operator<<(FArchive &Ar, FFluidSignedDistanceField &Field);
+
+private:
+	FVector Origin = FVector::ZeroVector; // World position of vertex (0, 0, 0)
+	float CellSize = 1.0f;
+	float BandWidth = 1.0f; // Distances are clamped to +/- this
+	FIntVector NumVertices = FIntVector::ZeroValue;
+	FIntVector NumBricks = FIntVector::ZeroValue;
+
+	TArray<int32> BrickOffsets; // Per brick: start of its samples in BrickSamples, or INDEX_NONE if it is uniform
+	TArray<float> BrickUniformDistances; // Per brick: distance of every vertex in a uniform brick
+	TArray<float> BrickSamples; // BrickSize^3 distances per allocated brick, X fastest
+	TArray<float> BrickCenterDistances; // Per brick: unclamped signed distance at its center, or 0 for bricks entirely outside
+	TArray<FVector3f> BrickCenterGradients; // Per brick: unit gradient at its center (away from the nearest surface point), or zero for bricks entirely outside
+
+	int32 GetBrickIndex(int32 BrickX, int32 BrickY, int32 BrickZ) const { return (BrickZ * NumBricks.Y + BrickY) * NumBricks.X + BrickX; }
+
+	float GetVertexDistance(int32 X, int32 Y, int32 Z) const; // Distance at a grid vertex; coordinates must be in range
+
+	FVector GetBrickCenter(int32 BrickX, int32 BrickY, int32 BrickZ) const { return Origin + (FVector(BrickX, BrickY, BrickZ) * BrickSize + 0.5 * (BrickSize - 1)) * CellSize; }
+};
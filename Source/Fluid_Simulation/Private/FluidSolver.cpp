@@ -0,0 +1,709 @@
+#include "FluidSolver.h"
+
+#include "Async/ParallelFor.h"
+
+
+SIZE_T FFluidSolver::GetAllocatedSize() const
+{
+    return Positions.GetAllocatedSize() + Velocities.GetAllocatedSize() + DensitiesAroundParticle.GetAllocatedSize() +
+        CompactState.GetAllocatedSize() + Pressures.GetAllocatedSize() + VelocityChanges.GetAllocatedSize() + TimingChecksums.GetAllocatedSize() +
+        DisplacementFactors.GetAllocatedSize() + DiagonalFactors.GetAllocatedSize() + AdvectedDensities.GetAllocatedSize() +
+        NeighborDisplacements.GetAllocatedSize() + NextPressures.GetAllocatedSize() + DensityErrors.GetAllocatedSize();
+}
+
+void FFluidSolver::Reset()
+{
+    Positions.Empty();
+    Velocities.Empty();
+    DensitiesAroundParticle.Empty();
+    NumOwned = 0;
+}
+
+int32 FFluidSolver::AddParticle(const FVector &Position, const FVector &Velocity)
+{
+    // Owned particles always come before ghosts, so drop the ghosts first; they are refreshed every step anyway
+    ClearGhosts();
+
+    Positions.Add(Position);
+    Velocities.Add(Velocity);
+    DensitiesAroundParticle.Add(0.0f); // Initialize density for this particle
+    return NumOwned++;
+}
+
+void FFluidSolver::RemoveParticleAtSwap(int32 Index)
+{
+    check(Index >= 0 && Index < NumOwned);
+    ClearGhosts();
+
+    Positions.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+    Velocities.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+    DensitiesAroundParticle.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+    --NumOwned;
+}
+
+void FFluidSolver::SetGhosts(const TArray<FVector> &GhostPositions, const TArray<FVector> &GhostVelocities)
+{
+    check(GhostPositions.Num() == GhostVelocities.Num());
+    ClearGhosts();
+
+    Positions.Append(GhostPositions);
+    Velocities.Append(GhostVelocities);
+    DensitiesAroundParticle.AddZeroed(GhostPositions.Num()); // Filled in by the density halo exchange
+}
+
+void FFluidSolver::ClearGhosts()
+{
+    Positions.SetNum(NumOwned, EAllowShrinking::No);
+    Velocities.SetNum(NumOwned, EAllowShrinking::No);
+    DensitiesAroundParticle.SetNum(NumOwned, EAllowShrinking::No);
+}
+
+void FFluidSolver::RegisterForceModule(const TSharedRef<IFluidForceModule> &Module)
+{
+    ForceModules.AddUnique(Module);
+}
+
+void FFluidSolver::SpawnParticleBlock(const FVector &Center, const FIntVector &CountPerAxis, float Spacing, float JitterFactor, FRandomStream &RandomStream)
+{
+    FVector HalfSpan(
+        (CountPerAxis.X > 1) ? (CountPerAxis.X - 1.0f) * Spacing / 2.0f : 0.0f,
+        (CountPerAxis.Y > 1) ? (CountPerAxis.Y - 1.0f) * Spacing / 2.0f : 0.0f,
+        (CountPerAxis.Z > 1) ? (CountPerAxis.Z - 1.0f) * Spacing / 2.0f : 0.0f);
+
+    for (int x = 0; x < CountPerAxis.X; x++)
+    {
+        for (int y = 0; y < CountPerAxis.Y; y++)
+        {
+            for (int z = 0; z < CountPerAxis.Z; z++)
+            {
+                FVector RelativeGridPos((float)x * Spacing, (float)y * Spacing, (float)z * Spacing);
+                FVector Position = Center + (RelativeGridPos - HalfSpan);
+
+                if (JitterFactor > KINDA_SMALL_NUMBER)
+                {
+                    Position.X += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
+                    Position.Y += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
+                    Position.Z += RandomStream.GetFraction() * 2.0f * JitterFactor - JitterFactor;
+                }
+
+                AddParticle(Position, FVector::ZeroVector);
+            }
+        }
+    }
+}
+
+void FFluidSolver::Step(float DeltaTime)
+{
+    ClearGhosts();
+
+    ApplyGravity(DeltaTime);
+    CalculateDensities();
+    ApplyPressureForces(DeltaTime);
+    ResolveBoundingBoxCollisions(DeltaTime);
+}
+
+void FFluidSolver::ApplyGravity(float DeltaTime)
+{
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            // Apply gravity to the particle's velocity
+            Velocities[Index] += FVector::DownVector * Params.Gravity * DeltaTime;
+
+            // TODO look into implementing predicted positions for increased time to get to system stability
+        });
+}
+
+void FFluidSolver::CalculateDensities()
+{
+    // Pre-calculate densities around each particle; they will be used by pressure calculations
+    if (UsesCompactNeighborState())
+    {
+        CompactState.PackPositions(Positions, Params.BoxCenter);
+        ParallelFor(NumOwned, [&](int32 Index)
+            {
+                DensitiesAroundParticle[Index] = CalculateCompactDensity(CompactState.GetPosition(Index));
+            });
+        return;
+    }
+
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            DensitiesAroundParticle[Index] = CalculateDensity(Positions[Index]);
+        });
+}
+
+void FFluidSolver::ApplyPressureForces(float DeltaTime)
+{
+    if (Params.PressureSolver == EFluidPressureSolver::Implicit)
+    {
+        ApplyImplicitPressureForces(DeltaTime);
+        return;
+    }
+
+    const bool bCompact = UsesCompactNeighborState();
+    if (bCompact)
+    {
+        // Ghost densities arrive after CalculateDensities, so they are packed here rather than there. They are stored
+        // relative to a lone particle's own density, W(0), which keeps them in fp16's normal range for any radius.
+        CompactState.PackDensities(DensitiesAroundParticle, CalculateSelfDensity(Params.SmoothingRadius));
+    }
+
+    // With any force module active, pressure moves to the fused loop so the modules share its neighbor traversal
+    if (ForceModules.ContainsByPredicate([&](const TSharedRef<IFluidForceModule> &Module) { return Module->IsActive(Params); }))
+    {
+        auto PressureAcceleration = [&](const FFluidParticlePair &Pair)
+            {
+                // Same as CalculatePressureForce divided by the particle's density; the kernel gradient is the slope
+                // times the direction away from the neighbor
+                float SharedPressure = CalculateSharedPressure(Pair.NeighborDensity, Pair.Density);
+                return -SharedPressure * Params.ParticleMass / Pair.NeighborDensity * Pair.KernelGradient / Pair.Density;
+            };
+        if (bCompact)
+        {
+            CompactState.PackVelocities(Velocities);
+            ApplyPairForces<true>(DeltaTime, PressureAcceleration);
+        }
+        else
+        {
+            ApplyPairForces<false>(DeltaTime, PressureAcceleration);
+        }
+        return;
+    }
+    ForceModuleStats.Reset();
+
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            // Calculate pressure force based on the density of the particle and its neighbors
+            FVector PressureForce = bCompact ? FVector(CalculateCompactPressureForce(Index)) : CalculatePressureForce(Index);
+
+            // F = m * a; but instead of mass, we use the density
+            FVector PressureAcceleration = PressureForce / DensitiesAroundParticle[Index];
+
+            // Update the particle's velocity based on the pressure acceleration
+            Velocities[Index] += PressureAcceleration * DeltaTime;
+        });
+}
+
+void FFluidSolver::ResolveBoundingBoxCollisions(float DeltaTime)
+{
+    const FVector MinBounds = Params.BoxCenter - Params.BoxExtent;
+    const FVector MaxBounds = Params.BoxCenter + Params.BoxExtent;
+    const float Radius = Params.ParticleRadius;
+    const float Restitution = Params.Restitution;
+    const FFluidSignedDistanceField *SignedDistanceField = Params.SignedDistanceField.Get();
+
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            FVector &Position = Positions[Index];
+            FVector &Velocity = Velocities[Index];
+
+            // Update particle's position (which is its WORLD position)
+            Position += Velocity * DeltaTime;
+
+            // Static obstacles first, so an obstacle pushing a particle out through a wall cannot undo the box clamp:
+            // one field sample per particle, pushed out along the gradient
+            if (SignedDistanceField)
+            {
+                FVector Gradient;
+                float Distance = SignedDistanceField->Sample(Position, Gradient);
+                if (Distance < Radius && Gradient.Normalize())
+                {
+                    Position += Gradient * (Radius - Distance);
+
+                    float NormalSpeed = FVector::DotProduct(Velocity, Gradient);
+                    if (NormalSpeed < 0.0f)
+                    {
+                        Velocity -= (1.0f + Restitution) * NormalSpeed * Gradient;
+                    }
+                }
+            }
+
+            // Check X-axis collision
+            if (Position.X - Radius < MinBounds.X)
+            {
+                Position.X = MinBounds.X + Radius;
+                Velocity.X *= -Restitution;
+            }
+            else if (Position.X + Radius > MaxBounds.X)
+            {
+                Position.X = MaxBounds.X - Radius;
+                Velocity.X *= -Restitution;
+            }
+
+            // Check Y-axis collision
+            if (Position.Y - Radius < MinBounds.Y)
+            {
+                Position.Y = MinBounds.Y + Radius;
+                Velocity.Y *= -Restitution;
+            }
+            else if (Position.Y + Radius > MaxBounds.Y)
+            {
+                Position.Y = MaxBounds.Y - Radius;
+                Velocity.Y *= -Restitution;
+            }
+
+            // Check Z-axis collision (floor and ceiling)
+            if (Position.Z - Radius < MinBounds.Z)
+            {
+                Position.Z = MinBounds.Z + Radius;
+                Velocity.Z *= -Restitution;
+                Velocity.X *= 0.9f;
+                Velocity.Y *= 0.9f;
+            }
+            else if (Position.Z + Radius > MaxBounds.Z)
+            {
+                Position.Z = MaxBounds.Z - Radius;
+                Velocity.Z *= -Restitution;
+            }
+        });
+}
+
+float SmoothingKernel(float Distance, float Radius)
+{
+	if (Distance >= Radius)
+	{
+		return 0.0f; // Outside the influence radius
+	}
+
+	float Volume = PI * pow(Radius, 4) / 6.0f;
+
+    return (Radius - Distance) * (Radius - Distance) / Volume;
+}
+
+float SmoothingKernelDerivative(float Distance, float Radius)
+{
+	if (Distance >= Radius)
+	{
+		return 0.0f; // Outside the influence radius
+	}
+
+	float Scale = 12 / (PI * pow(Radius, 4));
+	return (Distance - Radius) * Scale;
+}
+
+// Calls Callback(NeighborIndex, KernelGradient) for every particle within Radius of ParticleIndex. The gradient is
+// taken with respect to the first particle, i.e. it points from the neighbor towards ParticleIndex scaled by dW/dr.
+template <typename CallbackType>
+void ForEachNeighbor(const TArray<FVector> &Positions, int32 ParticleIndex, float Radius, CallbackType &&Callback)
+{
+    const FVector &Position = Positions[ParticleIndex];
+    const double RadiusSquared = Radius * Radius;
+
+    for (int32 NeighborIndex = 0; NeighborIndex < Positions.Num(); ++NeighborIndex)
+    {
+        FVector Offset = Position - Positions[NeighborIndex];
+        double DistanceSquared = Offset.SizeSquared();
+        if (NeighborIndex == ParticleIndex || DistanceSquared >= RadiusSquared || DistanceSquared == 0.0)
+        {
+            continue; // Skip the particle itself, particles outside the influence radius, and coincident particles with no gradient direction
+        }
+
+        float Distance = FMath::Sqrt(DistanceSquared);
+        Callback(NeighborIndex, Offset * (SmoothingKernelDerivative(Distance, Radius) / Distance));
+    }
+}
+
+template <bool bCompact, typename PairAccelerationType>
+void FFluidSolver::ApplyPairForces(float DeltaTime, PairAccelerationType &&PairAcceleration)
+{
+    // With Params.bProfileForceModules, every TimingStride-th particle is timed after the main loop, which costs
+    // (modules + 1) / TimingStride of a neighbor pass; see the sampling pass below
+    const int32 TimingStride = 64;
+    const float Radius = Params.SmoothingRadius;
+    const double RadiusSquared = Radius * Radius;
+
+    TArray<const IFluidForceModule *, TInlineAllocator<8>> ActiveModules;
+    for (const TSharedRef<IFluidForceModule> &Module : ForceModules)
+    {
+        if (Module->IsActive(Params))
+        {
+            ActiveModules.Add(&Module.Get());
+        }
+    }
+
+    // Calls Callback(Pair) for every neighbor within Radius of Index, built from the state this variant runs on
+    auto ForEachPair = [&](int32 Index, auto &&Callback)
+        {
+            [[maybe_unused]] const FVector3f CompactPosition = bCompact ? CompactState.GetPosition(Index) : FVector3f::ZeroVector;
+            FFluidParticlePair Pair;
+            Pair.ParticleIndex = Index;
+            // Both velocities of a pair come from the same state, so relative velocities are not skewed by precision
+            Pair.Velocity = bCompact ? FVector(CompactState.GetVelocity(Index)) : Velocities[Index];
+            Pair.Density = DensitiesAroundParticle[Index]; // The particle's own density stays float32, as in CalculateCompactPressureForce
+
+            for (int32 NeighborIndex = 0; NeighborIndex < Positions.Num(); ++NeighborIndex)
+            {
+                if constexpr (bCompact)
+                {
+                    Pair.Offset = FVector(
+                        CompactPosition.X - CompactState.PositionsX[NeighborIndex],
+                        CompactPosition.Y - CompactState.PositionsY[NeighborIndex],
+                        CompactPosition.Z - CompactState.PositionsZ[NeighborIndex]);
+                }
+                else
+                {
+                    Pair.Offset = Positions[Index] - Positions[NeighborIndex];
+                }
+                double DistanceSquared = Pair.Offset.SizeSquared();
+                if (NeighborIndex == Index || DistanceSquared >= RadiusSquared || DistanceSquared == 0.0)
+                {
+                    continue; // Skip the particle itself, particles outside the influence radius, and coincident particles
+                }
+
+                Pair.NeighborIndex = NeighborIndex;
+                if constexpr (bCompact)
+                {
+                    Pair.NeighborVelocity = FVector(CompactState.GetVelocity(NeighborIndex));
+                    Pair.NeighborDensity = CompactState.GetDensity(NeighborIndex);
+                }
+                else
+                {
+                    Pair.NeighborVelocity = Velocities[NeighborIndex];
+                    Pair.NeighborDensity = DensitiesAroundParticle[NeighborIndex];
+                }
+                Pair.Distance = FMath::Sqrt(DistanceSquared);
+                Pair.Kernel = SmoothingKernel(Pair.Distance, Radius);
+                Pair.KernelGradient = Pair.Offset * (SmoothingKernelDerivative(Pair.Distance, Radius) / Pair.Distance);
+
+                Callback(Pair);
+            }
+        };
+
+    VelocityChanges.SetNumUninitialized(NumOwned);
+
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            FVector Acceleration = FVector::ZeroVector;
+            FFluidPairAccumulator Accumulator;
+            ForEachPair(Index, [&](const FFluidParticlePair &Pair)
+                {
+                    Acceleration += PairAcceleration(Pair);
+                    for (const IFluidForceModule *Module : ActiveModules)
+                    {
+                        Module->AccumulatePair(*this, Pair, Accumulator);
+                    }
+                });
+
+            VelocityChanges[Index] = (Acceleration + Accumulator.Acceleration) * DeltaTime + Accumulator.VelocityCorrection;
+        });
+
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            Velocities[Index] += VelocityChanges[Index];
+        });
+
+    ForceModuleStats.Reset();
+    if (!Params.bProfileForceModules || ActiveModules.IsEmpty())
+    {
+        return;
+    }
+
+    // Sampling pass: for a sample of the particles, time a whole neighbor loop per module and one without any module.
+    // The difference is the module's cost; timing whole loops keeps clock reads out of the per-pair cost, and the
+    // clock overhead, identical in both, cancels out. Both loops feed TimingChecksums so neither can be optimized away.
+    // The modules only read particle state, so sampling after the velocity update times the same work.
+    const int32 NumSamples = (NumOwned + TimingStride - 1) / TimingStride;
+    TArray<int64, TInlineAllocator<8>> ModuleCycles;
+    ModuleCycles.SetNumZeroed(ActiveModules.Num());
+    TimingChecksums.SetNumUninitialized(NumSamples, EAllowShrinking::No);
+
+    ParallelFor(NumSamples, [&](int32 SampleIndex)
+        {
+            const int32 Index = SampleIndex * TimingStride;
+            double LocalChecksum = 0.0;
+
+            uint64 StartCycles = FPlatformTime::Cycles64();
+            ForEachPair(Index, [&](const FFluidParticlePair &Pair) { LocalChecksum += Pair.Kernel; });
+            const int64 BaselineCycles = FPlatformTime::Cycles64() - StartCycles;
+
+            for (int32 ModuleIndex = 0; ModuleIndex < ActiveModules.Num(); ++ModuleIndex)
+            {
+                FFluidPairAccumulator Accumulator;
+                StartCycles = FPlatformTime::Cycles64();
+                ForEachPair(Index, [&](const FFluidParticlePair &Pair)
+                    {
+                        LocalChecksum += Pair.Kernel;
+                        ActiveModules[ModuleIndex]->AccumulatePair(*this, Pair, Accumulator);
+                    });
+                const int64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+                LocalChecksum += Accumulator.Acceleration.X + Accumulator.VelocityCorrection.X;
+                FPlatformAtomics::InterlockedAdd(&ModuleCycles[ModuleIndex], Cycles - BaselineCycles);
+            }
+            TimingChecksums[SampleIndex] = LocalChecksum;
+        });
+
+    // CPU time summed over all worker threads, extrapolated from the sampled particles; timer noise can make a
+    // very cheap module come out slightly negative, so it is clamped
+    for (int32 ModuleIndex = 0; ModuleIndex < ActiveModules.Num(); ++ModuleIndex)
+    {
+        FFluidForceModuleStats &Stats = ForceModuleStats.AddDefaulted_GetRef();
+        Stats.Name = ActiveModules[ModuleIndex]->GetName();
+        Stats.Ms = FPlatformTime::ToMilliseconds64(FMath::Max<int64>(ModuleCycles[ModuleIndex], 0)) * NumOwned / FMath::Max(NumSamples, 1);
+    }
+}
+
+float FFluidSolver::CalculateDensity(const FVector &SamplePoint) const
+{
+    float Density = 0.0f;
+    const float Mass = 1.0f;
+
+    // TODO: optimize to only look at particles within smoothing radius
+    for (const FVector &Position : Positions)
+    {
+        float Distance = (Position - SamplePoint).Size();
+        float Influence = SmoothingKernel(Distance, Params.SmoothingRadius);
+        Density += Mass * Influence;
+    }
+    return Density;
+}
+
+float FFluidSolver::GetImplicitRestSpacing() const
+{
+    return Params.ParticleSpacing < Params.SmoothingRadius ? Params.ParticleSpacing : 0.5f * Params.SmoothingRadius;
+}
+
+float FFluidSolver::CalculateSelfDensity(float SmoothingRadius)
+{
+    return SmoothingKernel(0.0f, SmoothingRadius);
+}
+
+float FFluidSolver::CalculateLatticeDensity(float Spacing, float SmoothingRadius)
+{
+    // Lattice points beyond SmoothingRadius do not contribute; the reach is capped so tiny spacings stay cheap
+    const float SafeSpacing = FMath::Max(Spacing, KINDA_SMALL_NUMBER);
+    const int32 Reach = FMath::Min(FMath::FloorToInt(SmoothingRadius / SafeSpacing), 32);
+
+    float Density = 0.0f;
+    for (int32 Z = -Reach; Z <= Reach; ++Z)
+    {
+        for (int32 Y = -Reach; Y <= Reach; ++Y)
+        {
+            for (int32 X = -Reach; X <= Reach; ++X)
+            {
+                Density += SmoothingKernel(SafeSpacing * FMath::Sqrt((float)(X * X + Y * Y + Z * Z)), SmoothingRadius);
+            }
+        }
+    }
+    return Density;
+}
+
+float FFluidSolver::DensityToPressure(float Density) const
+{
+	// Calculate pressure based on the difference from target density
+	// This equation is better applicable for gasses but we will use it for liquids as well
+    float DensityDifference = (Params.TargetDensity - Density);
+	float Pressure = Params.PressureFactor * DensityDifference;
+	return Pressure;
+}
+
+float FFluidSolver::CalculateSharedPressure(float Density1, float Density2) const
+{
+	// Calculate shared pressure between two particles based on their densities
+	float Pressure1 = DensityToPressure(Density1);
+	float Pressure2 = DensityToPressure(Density2);
+	return (Pressure1 + Pressure2) / 2.0f; // Average pressure
+}
+
+FVector FFluidSolver::CalculatePressureForce(int32 ParticleIndex) const
+{
+    FVector PressureForce = FVector::ZeroVector;
+    for (int32 CurrentParticleIndex = 0; CurrentParticleIndex < Positions.Num(); ++CurrentParticleIndex)
+    {
+		if (CurrentParticleIndex == ParticleIndex)
+		{
+			continue; // Skip the particle itself
+		}
+
+		FVector OffsetBetweenParticles = (Positions[CurrentParticleIndex] - Positions[ParticleIndex]);
+		float Distance = OffsetBetweenParticles.Size();
+        FVector Direction = Distance == 0 ? FMath::VRand() : OffsetBetweenParticles / Distance;
+        float Slope = SmoothingKernelDerivative(Distance, Params.SmoothingRadius);
+        float Density = DensitiesAroundParticle[CurrentParticleIndex];
+		float SharedPressure = CalculateSharedPressure(Density, DensitiesAroundParticle[ParticleIndex]);
+        PressureForce += SharedPressure * Slope * Direction * Params.ParticleMass / Density;
+    }
+    return PressureForce;
+}
+
+float FFluidSolver::CalculateCompactDensity(const FVector3f &SamplePoint) const
+{
+    const float Radius = Params.SmoothingRadius;
+    const float RadiusSquared = Radius * Radius;
+    const float InverseVolume = 6.0f / (PI * Radius * Radius * Radius * Radius);
+    const int32 Count = CompactState.Num();
+
+    float Density = 0.0f;
+    for (int32 Index = 0; Index < Count; ++Index)
+    {
+        float DX = CompactState.PositionsX[Index] - SamplePoint.X;
+        float DY = CompactState.PositionsY[Index] - SamplePoint.Y;
+        float DZ = CompactState.PositionsZ[Index] - SamplePoint.Z;
+        float DistanceSquared = DX * DX + DY * DY + DZ * DZ;
+        if (DistanceSquared >= RadiusSquared)
+        {
+            continue; // Outside the influence radius
+        }
+
+        // Same kernel as SmoothingKernel with unit mass
+        float Falloff = Radius - FMath::Sqrt(DistanceSquared);
+        Density += Falloff * Falloff * InverseVolume;
+    }
+    return Density;
+}
+
+FVector3f FFluidSolver::CalculateCompactPressureForce(int32 ParticleIndex) const
+{
+    const float Radius = Params.SmoothingRadius;
+    const float RadiusSquared = Radius * Radius;
+    const float SlopeScale = 12.0f / (PI * Radius * Radius * Radius * Radius);
+    const FVector3f Position = CompactState.GetPosition(ParticleIndex);
+    const float Pressure = DensityToPressure(DensitiesAroundParticle[ParticleIndex]);
+    const int32 Count = CompactState.Num();
+
+    FVector3f PressureForce = FVector3f::ZeroVector;
+    for (int32 CurrentParticleIndex = 0; CurrentParticleIndex < Count; ++CurrentParticleIndex)
+    {
+        if (CurrentParticleIndex == ParticleIndex)
+        {
+            continue; // Skip the particle itself
+        }
+
+        FVector3f OffsetBetweenParticles(
+            CompactState.PositionsX[CurrentParticleIndex] - Position.X,
+            CompactState.PositionsY[CurrentParticleIndex] - Position.Y,
+            CompactState.PositionsZ[CurrentParticleIndex] - Position.Z);
+        float DistanceSquared = OffsetBetweenParticles.SizeSquared();
+        if (DistanceSquared >= RadiusSquared)
+        {
+            continue; // Slope is zero outside the influence radius
+        }
+
+        float Distance = FMath::Sqrt(DistanceSquared);
+        FVector3f Direction = Distance == 0 ? FVector3f(FMath::VRand()) : OffsetBetweenParticles / Distance;
+        float Slope = (Distance - Radius) * SlopeScale;
+        float Density = CompactState.GetDensity(CurrentParticleIndex);
+        float SharedPressure = (DensityToPressure(Density) + Pressure) / 2.0f;
+        PressureForce += SharedPressure * Slope * Direction * Params.ParticleMass / Density;
+    }
+    return PressureForce;
+}
+
+void FFluidSolver::ApplyImplicitPressureForces(float DeltaTime)
+{
+    // Implicit incompressible SPH (Ihmsen et al. 2014). Ghost pressures would have to be exchanged every iteration,
+    // so this path assumes the solver owns every particle it can see.
+    check(NumOwned == Num());
+
+    PressureStats = FFluidPressureSolveStats();
+    if (DeltaTime <= KINDA_SMALL_NUMBER || NumOwned == 0)
+    {
+        return;
+    }
+
+    // DensitiesAroundParticle is a unit mass kernel sum; the pressure system works on mass densities, Mass times that
+    const float Mass = Params.ParticleMass;
+    const float Radius = Params.SmoothingRadius;
+    // TargetDensity is an equation of state knob in arbitrary units and is typically far above anything the kernel can
+    // reach, which would leave every pressure clamped to zero; the rest density comes from the rest lattice instead
+    const float RestDensity = GetImplicitRestDensity();
+    const float DeltaTimeSquared = DeltaTime * DeltaTime;
+    const float Relaxation = Params.PressureRelaxation;
+
+    if (Pressures.Num() != NumOwned)
+    {
+        Pressures.Init(0.0f, NumOwned); // Particle set changed; drop the warm start
+    }
+    DisplacementFactors.SetNumUninitialized(NumOwned);
+    DiagonalFactors.SetNumUninitialized(NumOwned);
+    AdvectedDensities.SetNumUninitialized(NumOwned);
+    NeighborDisplacements.SetNumUninitialized(NumOwned);
+    NextPressures.SetNumUninitialized(NumOwned);
+    DensityErrors.SetNumUninitialized(NumOwned);
+
+    // Velocities only contain gravity so far; predict the density they lead to and build the diagonal of the system
+    ParallelFor(NumOwned, [&](int32 Index)
+        {
+            const float Density = Mass * DensitiesAroundParticle[Index];
+            const float InverseDensitySquared = 1.0f / (Density * Density);
+            FVector SumGradient = FVector::ZeroVector;
+            float SumGradientSquared = 0.0f;
+            float DensityChange = 0.0f;
+
+            ForEachNeighbor(Positions, Index, Radius, [&](int32 NeighborIndex, const FVector &Gradient)
+                {
+                    SumGradient += Mass * Gradient;
+                    SumGradientSquared += Mass * Mass * Gradient.SizeSquared();
+                    DensityChange += Mass * FVector::DotProduct(Velocities[Index] - Velocities[NeighborIndex], Gradient);
+                });
+
+            DisplacementFactors[Index] = -DeltaTimeSquared * InverseDensitySquared * SumGradient;
+            DiagonalFactors[Index] = FVector::DotProduct(DisplacementFactors[Index], SumGradient) - DeltaTimeSquared * InverseDensitySquared * SumGradientSquared;
+            AdvectedDensities[Index] = Density + DeltaTime * DensityChange;
+            Pressures[Index] *= 0.5f; // Warm start from half of last step's pressure
+        });
+
+    for (int32 Iteration = 0; Iteration < Params.MaxPressureIterations; ++Iteration)
+    {
+        ParallelFor(NumOwned, [&](int32 Index)
+            {
+                FVector Displacement = FVector::ZeroVector;
+                ForEachNeighbor(Positions, Index, Radius, [&](int32 NeighborIndex, const FVector &Gradient)
+                    {
+                        const float NeighborDensity = Mass * DensitiesAroundParticle[NeighborIndex];
+                        Displacement -= DeltaTimeSquared * Mass / (NeighborDensity * NeighborDensity) * Pressures[NeighborIndex] * Gradient;
+                    });
+                NeighborDisplacements[Index] = Displacement;
+            });
+
+        ParallelFor(NumOwned, [&](int32 Index)
+            {
+                const float Density = Mass * DensitiesAroundParticle[Index];
+                const float DeltaTimeSquaredOverDensitySquared = DeltaTimeSquared * Mass / (Density * Density);
+                float Sum = 0.0f;
+
+                ForEachNeighbor(Positions, Index, Radius, [&](int32 NeighborIndex, const FVector &Gradient)
+                    {
+                        // Displacement of the neighbor from everything except this particle's pressure
+                        FVector NeighborDisplacement = NeighborDisplacements[NeighborIndex] - DeltaTimeSquaredOverDensitySquared * Gradient * Pressures[Index];
+                        FVector RelativeDisplacement = NeighborDisplacements[Index] - DisplacementFactors[NeighborIndex] * Pressures[NeighborIndex] - NeighborDisplacement;
+                        Sum += Mass * FVector::DotProduct(RelativeDisplacement, Gradient);
+                    });
+
+                const float Diagonal = DiagonalFactors[Index];
+                float Pressure = (1.0f - Relaxation) * Pressures[Index];
+                if (FMath::Abs(Diagonal) > SMALL_NUMBER)
+                {
+                    Pressure += Relaxation / Diagonal * (RestDensity - AdvectedDensities[Index] - Sum);
+                }
+                Pressure = FMath::Max(Pressure, 0.0f); // Clamp so the free surface is not pulled together
+
+                NextPressures[Index] = Pressure;
+                DensityErrors[Index] = FMath::Max(AdvectedDensities[Index] + Diagonal * Pressure + Sum - RestDensity, 0.0f);
+            });
+
+        Swap(Pressures, NextPressures);
+
+        float SumDensityError = 0.0f;
+        for (float DensityError : DensityErrors)
+        {
+            SumDensityError += DensityError;
+        }
+        PressureStats.Iterations = Iteration + 1;
+        PressureStats.DensityError = SumDensityError / (NumOwned * FMath::Max(RestDensity, KINDA_SMALL_NUMBER));
+
+        // Always run two iterations; the first one only sees the warm start
+        if (Iteration >= 1 && PressureStats.DensityError < Params.PressureTolerance)
+        {
+            break;
+        }
+    }
+
+    // Apply the converged pressures; force modules ride along on the same full-precision neighbor loop, whose pair
+    // densities are unit mass kernel sums
+    ApplyPairForces<false>(DeltaTime, [&](const FFluidParticlePair &Pair)
+        {
+            const float Density = Mass * Pair.Density;
+            const float NeighborDensity = Mass * Pair.NeighborDensity;
+            return -Mass * (Pressures[Pair.ParticleIndex] / (Density * Density) + Pressures[Pair.NeighborIndex] / (NeighborDensity * NeighborDensity)) * Pair.KernelGradient;
+        });
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FluidCompactState.h"
+#include "FluidForceModule.h"
+#include "FluidSignedDistanceField.h"
+#include "FluidSolver.generated.h"
+
+// How pressure forces are computed from densities
+UENUM(BlueprintType)
+enum class EFluidPressureSolver : uint8
+{
+	EquationOfState UMETA(DisplayName = "Equation Of State"), // Linear PressureFactor * (TargetDensity - Density); cheap but stiff
+	Implicit UMETA(DisplayName = "Implicit (IISPH)"), // Relaxed Jacobi iteration until the predicted density error is below tolerance
+};
+
+// Simulation parameters consumed by FFluidSolver; mirrors the editable properties on ABoundingRectangularPrism
+struct FFluidSolverParams
+{
+	FVector BoxCenter = FVector::ZeroVector; // World location of the bounding box center
+	FVector BoxExtent = FVector(100.0f, 200.0f, 200.0f); // Half size of the bounding box along X, Y, Z
+	float Gravity = 200.0f;
+	float ParticleRadius = 10.0f;
+	float ParticleMass = 1.0f;
+	float TargetDensity = 3.0f; // Equation of state only, in unit mass kernel units; the implicit solver derives its rest density from ParticleSpacing
+	float PressureFactor = 500.0f;
+	float SmoothingRadius = 25.0f;
+	float Restitution = 0.8f;
+	bool bCompactNeighborState = false; // Equation of state only: run the neighbor passes, force modules included, on float32/fp16 FFluidCompactParticleState
+	EFluidPressureSolver PressureSolver = EFluidPressureSolver::EquationOfState;
+	float ParticleSpacing = 30.0f; // Implicit only: rest spacing of the particles; the rest density is that of a cubic lattice at this spacing (see GetImplicitRestSpacing)
+	float PressureTolerance = 0.01f; // Implicit only: stop iterating once the average density error is below this fraction of the rest density
+	int32 MaxPressureIterations = 50; // Implicit only: upper bound on Jacobi iterations per step
+	float PressureRelaxation = 0.5f; // Implicit only: Jacobi relaxation factor (omega)
+	float ArtificialViscosity = 0.0f; // FFluidViscosityModule alpha; 0 disables the module
+	float XSPHFactor = 0.0f; // FFluidXSPHModule epsilon; 0 disables the module
+	float SurfaceTension = 0.0f; // FFluidCohesionModule strength; 0 disables the module
+	bool bProfileForceModules = false; // Sample the cost of each active force module into ForceModuleStats; adds (modules + 1) / 64 of a neighbor pass
+	TSharedPtr<const FFluidSignedDistanceField> SignedDistanceField; // Static obstacles baked by ABoundingRectangularPrism; shared read-only between solver copies
+
+	bool operator==(const FFluidSolverParams &Other) const = default;
+};
+
+// Convergence of the last implicit pressure solve
+struct FFluidPressureSolveStats
+{
+	int32 Iterations = 0;
+	float DensityError = 0.0f; // Average compression relative to the rest density after the last iteration
+};
+
+// Headless SPH solver. Particle state lives in plain arrays so the simulation can be stepped without
+// spawning any AParticle actors (benchmarks, commandlets, domain decomposition ranks).
+//
+// Particles [0, NumOwned) are simulated by this solver. Particles [NumOwned, Num()) are ghosts: read-only
+// copies of particles owned by a neighbouring domain that only contribute to the neighbor passes.
+class FFluidSolver
+{
+public:
+	FFluidSolverParams Params;
+
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<float> DensitiesAroundParticle; // Density sampled at each particle, including ghosts
+
+	int32 NumOwned = 0; // Number of particles simulated by this solver; the rest are ghosts
+
+	FFluidCompactParticleState CompactState; // Repacked every step while UsesCompactNeighborState()
+
+	TArray<float> Pressures; // Implicit only: pressure per owned particle, kept between steps to warm start the iteration
+	FFluidPressureSolveStats PressureStats; // Implicit only: convergence of the last step
+
+	TArray<FFluidForceModuleStats> ForceModuleStats; // Time spent in each active force module during the last step; empty unless Params.bProfileForceModules
+
+	int32 Num() const { return Positions.Num(); }
+
+	SIZE_T GetAllocatedSize() const; // Heap memory held for particle state, the compact copy and solver scratch
+
+	// The implicit solver always runs at full precision, so the compact state is only used with the equation of state;
+	// every neighbor pass of a step then reads the same state
+	bool UsesCompactNeighborState() const { return Params.bCompactNeighborState && Params.PressureSolver == EFluidPressureSolver::EquationOfState; }
+
+	void Reset(); // Remove all owned and ghost particles
+
+	int32 AddParticle(const FVector &Position, const FVector &Velocity); // Add an owned particle, returns its index
+
+	void RemoveParticleAtSwap(int32 Index); // Remove an owned particle; the last owned particle takes its index
+
+	void SetGhosts(const TArray<FVector> &GhostPositions, const TArray<FVector> &GhostVelocities); // Replace all ghosts
+
+	void ClearGhosts(); // Drop all ghosts, leaving only owned particles
+
+	void RegisterForceModule(const TSharedRef<IFluidForceModule> &Module); // Evaluate Module inside the pressure neighbor loop
+
+	const TArray<TSharedRef<IFluidForceModule>> &GetForceModules() const { return ForceModules; }
+
+	void SetForceModules(const TArray<TSharedRef<IFluidForceModule>> &Modules) { ForceModules = Modules; }
+
+	// Append a jittered grid of owned particles centered on Center
+	void SpawnParticleBlock(const FVector &Center, const FIntVector &CountPerAxis, float Spacing, float JitterFactor, FRandomStream &RandomStream);
+
+	// Advance owned particles by one full step (gravity, density, pressure, integration and collisions)
+	void Step(float DeltaTime);
+
+	/* Individual passes; Step runs them in order, domain decomposition interleaves halo exchanges between them */
+	void ApplyGravity(float DeltaTime); // Apply gravity to the owned particles' velocities
+
+	void CalculateDensities(); // Pre-calculate densities around each owned particle
+
+	void ApplyPressureForces(float DeltaTime); // Calculate pressure forces and apply them to the owned particles' velocities
+
+	void ApplyImplicitPressureForces(float DeltaTime); // IISPH: solve for pressures that bring the predicted density to TargetDensity
+
+	void ResolveBoundingBoxCollisions(float DeltaTime); // Update owned particle positions and bounce them off the bounding box and Params.SignedDistanceField
+
+	/* Methods to calculate particle forces on each other */
+	float CalculateDensity(const FVector &SamplePoint) const; // Calculate the density at a given position based on particle positions
+
+	static float CalculateSelfDensity(float SmoothingRadius); // Kernel at zero distance, W(0); the compact state packs densities relative to it
+	static float CalculateLatticeDensity(float Spacing, float SmoothingRadius); // Density at a particle of an infinite cubic lattice, in CalculateDensity's unit mass kernel units
+
+	// Rest spacing of the implicit solver: ParticleSpacing, unless a lattice that sparse has no neighbours within SmoothingRadius
+	// and the rest density would be the particle's own kernel weight alone; then half the smoothing radius (26 neighbours)
+	float GetImplicitRestSpacing() const;
+
+	float GetImplicitRestDensity() const { return Params.ParticleMass * CalculateLatticeDensity(GetImplicitRestSpacing(), Params.SmoothingRadius); } // Mass density the implicit solver drives particles towards
+
+	float DensityToPressure(float Density) const; // Convert density to pressure based on target density and pressure factor
+
+	float CalculateSharedPressure(float Density1, float Density2) const; // Calculate shared pressure between two particles based on their densities
+
+	FVector CalculatePressureForce(int32 ParticleIndex) const; // Calculate the pressure force on a particle based on its density and position relative to other particles
+
+	/* Compact state variants of the neighbor loops; positions are relative to CompactState.Origin */
+	float CalculateCompactDensity(const FVector3f &SamplePoint) const;
+
+	FVector3f CalculateCompactPressureForce(int32 ParticleIndex) const;
+
+private:
+	// Fused neighbor loop: adds PairAcceleration(Pair) plus every active force module for each pair, then applies the
+	// summed velocity change once all particles are done so modules always read this step's velocities. bCompact
+	// builds the pairs from CompactState instead of the full-precision arrays.
+	template <bool bCompact, typename PairAccelerationType>
+	void ApplyPairForces(float DeltaTime, PairAccelerationType &&PairAcceleration);
+
+	TArray<TSharedRef<IFluidForceModule>> ForceModules;
+	TArray<FVector> VelocityChanges; // Fused loop output, one entry per owned particle
+	TArray<double> TimingChecksums; // Written by the fused loop's timing samples so the timed loops cannot be optimized away
+
+	/* Implicit pressure solve scratch, one entry per owned particle */
+	TArray<FVector> DisplacementFactors; // d_ii: displacement of a particle caused by its own pressure, per unit pressure
+	TArray<float> DiagonalFactors; // a_ii: diagonal of the pressure Poisson system
+	TArray<float> AdvectedDensities; // Density predicted from the non-pressure velocities alone
+	TArray<FVector> NeighborDisplacements; // Sum over neighbors of d_ij * p_j
+	TArray<float> NextPressures; // Jacobi output buffer
+	TArray<float> DensityErrors; // Predicted compression of each particle in the current iteration
+};
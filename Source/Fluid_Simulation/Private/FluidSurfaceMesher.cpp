@@ -0,0 +1,420 @@
+#include "FluidSurfaceMesher.h"
+
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    // Marching cubes case table. Rather than a hand typed table it is derived from the cube's topology: on every face
+    // the crossed edges are joined by segments, the segments are chained into closed loops and every loop is fanned
+    // into triangles. Ambiguous faces always cut off their inside corners separately, so two cells sharing a face
+    // make the same choice and the surface has no cracks. Triangle winding is fixed at extraction time.
+    struct FMarchingCubesTable
+    {
+        static constexpr int32 MaxIndices = 15; // No case needs more than five triangles
+
+        int32 EdgeCorners[12][2]; // Corner i sits at offset (i & 1, (i >> 1) & 1, (i >> 2) & 1); edge / 4 is its axis
+        int32 NumIndices[256];
+        int8 Indices[256][MaxIndices]; // Cube edge of each triangle vertex, three per triangle
+    };
+
+    FMarchingCubesTable BuildMarchingCubesTable()
+    {
+        FMarchingCubesTable Table;
+        int32 EdgeBetween[8][8];
+        int32 NumEdges = 0;
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            for (int32 Corner = 0; Corner < 8; ++Corner)
+            {
+                if ((Corner & (1 << Axis)) == 0)
+                {
+                    const int32 Other = Corner | (1 << Axis);
+                    Table.EdgeCorners[NumEdges][0] = Corner;
+                    Table.EdgeCorners[NumEdges][1] = Other;
+                    EdgeBetween[Corner][Other] = NumEdges;
+                    EdgeBetween[Other][Corner] = NumEdges;
+                    ++NumEdges;
+                }
+            }
+        }
+
+        for (int32 Case = 0; Case < 256; ++Case)
+        {
+            // Every crossed edge lies on two faces, so it ends up linked to exactly two other crossed edges
+            int32 Links[12][2];
+            int32 NumLinks[12] = {};
+            auto AddSegment = [&](int32 EdgeA, int32 EdgeB)
+            {
+                Links[EdgeA][NumLinks[EdgeA]++] = EdgeB;
+                Links[EdgeB][NumLinks[EdgeB]++] = EdgeA;
+            };
+
+            for (int32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const int32 U = 1 << ((Axis + 1) % 3);
+                const int32 V = 1 << ((Axis + 2) % 3);
+                for (int32 Side = 0; Side < 2; ++Side)
+                {
+                    const int32 Base = Side << Axis;
+                    const int32 FaceCorners[4] = { Base, Base | U, Base | U | V, Base | V };
+                    bool bInside[4];
+                    int32 FaceEdges[4]; // Edge from face corner K to face corner K + 1
+                    for (int32 K = 0; K < 4; ++K)
+                    {
+                        bInside[K] = ((Case >> FaceCorners[K]) & 1) != 0;
+                        FaceEdges[K] = EdgeBetween[FaceCorners[K]][FaceCorners[(K + 1) % 4]];
+                    }
+
+                    int32 Crossed[4];
+                    int32 NumCrossed = 0;
+                    for (int32 K = 0; K < 4; ++K)
+                    {
+                        if (bInside[K] != bInside[(K + 1) % 4])
+                        {
+                            Crossed[NumCrossed++] = FaceEdges[K];
+                        }
+                    }
+
+                    if (NumCrossed == 2)
+                    {
+                        AddSegment(Crossed[0], Crossed[1]);
+                    }
+                    else if (NumCrossed == 4)
+                    {
+                        // Ambiguous face (diagonal corners inside): cut off each inside corner on its own
+                        for (int32 K = 0; K < 4; ++K)
+                        {
+                            if (bInside[K])
+                            {
+                                AddSegment(FaceEdges[(K + 3) % 4], FaceEdges[K]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            bool bVisited[12] = {};
+            int32 &NumIndices = Table.NumIndices[Case];
+            NumIndices = 0;
+            for (int32 Start = 0; Start < 12; ++Start)
+            {
+                if (NumLinks[Start] == 0 || bVisited[Start])
+                {
+                    continue;
+                }
+
+                int32 Loop[12];
+                int32 LoopLength = 0;
+                int32 Previous = INDEX_NONE;
+                int32 Current = Start;
+                do
+                {
+                    bVisited[Current] = true;
+                    Loop[LoopLength++] = Current;
+                    const int32 Next = (Links[Current][0] != Previous) ? Links[Current][0] : Links[Current][1];
+                    Previous = Current;
+                    Current = Next;
+                } while (Current != Start);
+
+                for (int32 Index = 1; Index + 1 < LoopLength; ++Index)
+                {
+                    Table.Indices[Case][NumIndices++] = (int8)Loop[0];
+                    Table.Indices[Case][NumIndices++] = (int8)Loop[Index];
+                    Table.Indices[Case][NumIndices++] = (int8)Loop[Index + 1];
+                }
+            }
+            check(NumIndices <= FMarchingCubesTable::MaxIndices);
+        }
+        return Table;
+    }
+
+    const FMarchingCubesTable &GetMarchingCubesTable()
+    {
+        static const FMarchingCubesTable Table = BuildMarchingCubesTable();
+        return Table;
+    }
+
+    // Integer division rounding towards negative infinity, for block coordinates left of or below the world origin
+    int32 FloorDivide(int32 Value, int32 Divisor)
+    {
+        return (Value >= 0) ? Value / Divisor : -((Divisor - 1 - Value) / Divisor);
+    }
+}
+
+bool FFluidSurfaceMesher::Update(TArrayView<const FVector> Positions)
+{
+    const double StartTime = FPlatformTime::Seconds();
+
+    if (Params.CellSize <= KINDA_SMALL_NUMBER || Params.KernelRadius <= KINDA_SMALL_NUMBER || Params.BlockSize < 1)
+    {
+        UE_LOG(LogTemp, Error, TEXT("FFluidSurfaceMesher: CellSize, KernelRadius and BlockSize must be positive."));
+        return false;
+    }
+
+    // Blocks meshed with other settings do not line up with the new grid
+    if (!(Params == MeshedParams))
+    {
+        Reset();
+        MeshedParams = Params;
+    }
+
+    for (TPair<FIntVector, FBlock> &Entry : Blocks)
+    {
+        Entry.Value.ParticleIndices.Reset();
+        Entry.Value.NextSignature = 0;
+        Entry.Value.bTouched = false;
+    }
+
+    // Bin every particle into the blocks it splats onto. A block stores nodes [-1, BlockSize + 1] relative to its first
+    // cell so that gradients at its own nodes can use central differences.
+    const int32 BlockSize = Params.BlockSize;
+    const double ReachInCells = Params.KernelRadius / Params.CellSize;
+    const double Quantum = FMath::Max(Params.RemeshTolerance, KINDA_SMALL_NUMBER);
+    for (int32 Index = 0; Index < Positions.Num(); ++Index)
+    {
+        const FVector Cell = Positions[Index] / Params.CellSize;
+        const FIntVector MinBlock(
+            FloorDivide(FMath::CeilToInt(Cell.X - ReachInCells) - 2, BlockSize),
+            FloorDivide(FMath::CeilToInt(Cell.Y - ReachInCells) - 2, BlockSize),
+            FloorDivide(FMath::CeilToInt(Cell.Z - ReachInCells) - 2, BlockSize));
+        const FIntVector MaxBlock(
+            FloorDivide(FMath::FloorToInt(Cell.X + ReachInCells) + 1, BlockSize),
+            FloorDivide(FMath::FloorToInt(Cell.Y + ReachInCells) + 1, BlockSize),
+            FloorDivide(FMath::FloorToInt(Cell.Z + ReachInCells) + 1, BlockSize));
+
+        // Summed into the block signature, so a block only goes dirty once a particle crosses a tolerance boundary
+        const FIntVector Quantized(
+            FMath::FloorToInt(Positions[Index].X / Quantum),
+            FMath::FloorToInt(Positions[Index].Y / Quantum),
+            FMath::FloorToInt(Positions[Index].Z / Quantum));
+        const uint64 ParticleHash = (uint64)HashCombineFast(GetTypeHash(Quantized), GetTypeHash(Index)) * 0x9E3779B97F4A7C15ull;
+
+        for (int32 BlockZ = MinBlock.Z; BlockZ <= MaxBlock.Z; ++BlockZ)
+        {
+            for (int32 BlockY = MinBlock.Y; BlockY <= MaxBlock.Y; ++BlockY)
+            {
+                for (int32 BlockX = MinBlock.X; BlockX <= MaxBlock.X; ++BlockX)
+                {
+                    FBlock &Block = Blocks.FindOrAdd(FIntVector(BlockX, BlockY, BlockZ));
+                    Block.ParticleIndices.Add(Index);
+                    Block.NextSignature += ParticleHash;
+                    Block.bTouched = true;
+                }
+            }
+        }
+    }
+
+    // Blocks no particle reaches any more simply disappear from the mesh
+    bool bChanged = false;
+    for (auto It = Blocks.CreateIterator(); It; ++It)
+    {
+        if (!It.Value().bTouched)
+        {
+            It.RemoveCurrent();
+            bChanged = true;
+        }
+    }
+
+    TArray<TPair<FIntVector, FBlock *>> DirtyBlocks;
+    for (TPair<FIntVector, FBlock> &Entry : Blocks)
+    {
+        if (!Entry.Value.bMeshed || Entry.Value.NextSignature != Entry.Value.Signature)
+        {
+            DirtyBlocks.Add(TPair<FIntVector, FBlock *>(Entry.Key, &Entry.Value));
+        }
+    }
+
+    ParallelFor(DirtyBlocks.Num(), [&](int32 Index)
+        {
+            FBlock &Block = *DirtyBlocks[Index].Value;
+            MeshBlock(DirtyBlocks[Index].Key, Block, Positions);
+            Block.Signature = Block.NextSignature;
+            Block.bMeshed = true;
+        });
+
+    bChanged |= DirtyBlocks.Num() > 0;
+    if (bChanged)
+    {
+        AssembleMesh();
+    }
+
+    Stats.NumBlocks = Blocks.Num();
+    Stats.NumDirtyBlocks = DirtyBlocks.Num();
+    Stats.NumVertices = Vertices.Num();
+    Stats.NumTriangles = Triangles.Num() / 3;
+    Stats.Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    return bChanged;
+}
+
+void FFluidSurfaceMesher::Reset()
+{
+    Blocks.Empty();
+    Vertices.Empty();
+    Normals.Empty();
+    Triangles.Empty();
+    Stats = FFluidSurfaceMesherStats();
+}
+
+void FFluidSurfaceMesher::MeshBlock(const FIntVector &BlockCoord, FBlock &Block, TArrayView<const FVector> Positions) const
+{
+    const FMarchingCubesTable &Table = GetMarchingCubesTable();
+    const int32 BlockSize = Params.BlockSize;
+    const int32 NodesPerAxis = BlockSize + 3; // Stored nodes per axis, including the border on both sides
+    const int32 EdgeNodesPerAxis = BlockSize + 1; // Nodes that own the edges of this block's cells
+    const double CellSize = Params.CellSize;
+    const double RadiusSquared = Params.KernelRadius * Params.KernelRadius;
+    const float IsoLevel = Params.IsoLevel;
+    const FIntVector FirstNode = BlockCoord * BlockSize - FIntVector(1); // Global coordinate of stored node (0, 0, 0)
+
+    auto DensityIndex = [NodesPerAxis](int32 X, int32 Y, int32 Z) { return (Z * NodesPerAxis + Y) * NodesPerAxis + X; };
+
+    // Splat; distances come from global node coordinates so blocks sharing a node compute the exact same density there
+    Block.Densities.SetNumUninitialized(NodesPerAxis * NodesPerAxis * NodesPerAxis, EAllowShrinking::No);
+    FMemory::Memzero(Block.Densities.GetData(), Block.Densities.Num() * sizeof(float));
+    const double ReachInCells = Params.KernelRadius / CellSize;
+    for (int32 ParticleIndex : Block.ParticleIndices)
+    {
+        const FVector &Position = Positions[ParticleIndex];
+        const FVector Cell = Position / CellSize - FVector(FirstNode);
+        const int32 MinX = FMath::Max(FMath::CeilToInt(Cell.X - ReachInCells), 0);
+        const int32 MinY = FMath::Max(FMath::CeilToInt(Cell.Y - ReachInCells), 0);
+        const int32 MinZ = FMath::Max(FMath::CeilToInt(Cell.Z - ReachInCells), 0);
+        const int32 MaxX = FMath::Min(FMath::FloorToInt(Cell.X + ReachInCells), NodesPerAxis - 1);
+        const int32 MaxY = FMath::Min(FMath::FloorToInt(Cell.Y + ReachInCells), NodesPerAxis - 1);
+        const int32 MaxZ = FMath::Min(FMath::FloorToInt(Cell.Z + ReachInCells), NodesPerAxis - 1);
+
+        for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+        {
+            const double DZ = (FirstNode.Z + Z) * CellSize - Position.Z;
+            for (int32 Y = MinY; Y <= MaxY; ++Y)
+            {
+                const double DY = (FirstNode.Y + Y) * CellSize - Position.Y;
+                for (int32 X = MinX; X <= MaxX; ++X)
+                {
+                    const double DX = (FirstNode.X + X) * CellSize - Position.X;
+                    const double Falloff = 1.0 - (DX * DX + DY * DY + DZ * DZ) / RadiusSquared;
+                    if (Falloff > 0.0)
+                    {
+                        Block.Densities[DensityIndex(X, Y, Z)] += (float)(Falloff * Falloff * Falloff);
+                    }
+                }
+            }
+        }
+    }
+
+    // Marching cubes over the block's own cells; stored coordinates are offset by the one node border
+    Block.EdgeVertices.Init(INDEX_NONE, EdgeNodesPerAxis * EdgeNodesPerAxis * EdgeNodesPerAxis * 3);
+    Block.Vertices.Reset();
+    Block.Normals.Reset();
+    Block.Triangles.Reset();
+
+    auto DensityGradient = [&](int32 X, int32 Y, int32 Z)
+    {
+        return FVector(
+            Block.Densities[DensityIndex(X + 1, Y, Z)] - Block.Densities[DensityIndex(X - 1, Y, Z)],
+            Block.Densities[DensityIndex(X, Y + 1, Z)] - Block.Densities[DensityIndex(X, Y - 1, Z)],
+            Block.Densities[DensityIndex(X, Y, Z + 1)] - Block.Densities[DensityIndex(X, Y, Z - 1)]) / (2.0 * CellSize);
+    };
+
+    for (int32 CellZ = 0; CellZ < BlockSize; ++CellZ)
+    {
+        for (int32 CellY = 0; CellY < BlockSize; ++CellY)
+        {
+            for (int32 CellX = 0; CellX < BlockSize; ++CellX)
+            {
+                float CornerDensities[8];
+                int32 Case = 0;
+                for (int32 Corner = 0; Corner < 8; ++Corner)
+                {
+                    CornerDensities[Corner] = Block.Densities[DensityIndex(CellX + 1 + (Corner & 1), CellY + 1 + ((Corner >> 1) & 1), CellZ + 1 + ((Corner >> 2) & 1))];
+                    Case |= (CornerDensities[Corner] >= IsoLevel) ? (1 << Corner) : 0;
+                }
+                if (Table.NumIndices[Case] == 0)
+                {
+                    continue; // Entirely inside or outside the fluid
+                }
+
+                // Vertices are shared between the cells of a block through the node that owns each edge
+                auto GetEdgeVertex = [&](int32 Edge)
+                {
+                    const int32 Corner0 = Table.EdgeCorners[Edge][0];
+                    const int32 Corner1 = Table.EdgeCorners[Edge][1];
+                    const FIntVector Node(CellX + (Corner0 & 1), CellY + ((Corner0 >> 1) & 1), CellZ + ((Corner0 >> 2) & 1));
+                    int32 &VertexIndex = Block.EdgeVertices[((Node.Z * EdgeNodesPerAxis + Node.Y) * EdgeNodesPerAxis + Node.X) * 3 + Edge / 4];
+                    if (VertexIndex == INDEX_NONE)
+                    {
+                        const float Density0 = CornerDensities[Corner0];
+                        const float Density1 = CornerDensities[Corner1];
+                        const float Alpha = FMath::Clamp((IsoLevel - Density0) / (Density1 - Density0), 0.0f, 1.0f);
+                        const FIntVector AxisStep(Edge / 4 == 0 ? 1 : 0, Edge / 4 == 1 ? 1 : 0, Edge / 4 == 2 ? 1 : 0);
+
+                        const FVector Position0 = FVector(FirstNode + FIntVector(1) + Node) * CellSize;
+                        const FVector Gradient0 = DensityGradient(Node.X + 1, Node.Y + 1, Node.Z + 1);
+                        const FVector Gradient1 = DensityGradient(Node.X + 1 + AxisStep.X, Node.Y + 1 + AxisStep.Y, Node.Z + 1 + AxisStep.Z);
+
+                        VertexIndex = Block.Vertices.Add(Position0 + FVector(AxisStep) * (Alpha * CellSize));
+                        Block.Normals.Add(-FMath::Lerp(Gradient0, Gradient1, (double)Alpha).GetSafeNormal()); // Density falls off out of the fluid
+                    }
+                    return VertexIndex;
+                };
+
+                for (int32 Index = 0; Index < Table.NumIndices[Case]; Index += 3)
+                {
+                    int32 A = GetEdgeVertex(Table.Indices[Case][Index]);
+                    int32 B = GetEdgeVertex(Table.Indices[Case][Index + 1]);
+                    int32 C = GetEdgeVertex(Table.Indices[Case][Index + 2]);
+
+                    // Same front face convention as AParticle's spheres: CrossProduct(B - A, C - A) points out of the fluid
+                    const FVector FaceNormal = FVector::CrossProduct(Block.Vertices[B] - Block.Vertices[A], Block.Vertices[C] - Block.Vertices[A]);
+                    if (FVector::DotProduct(FaceNormal, Block.Normals[A] + Block.Normals[B] + Block.Normals[C]) < 0.0)
+                    {
+                        Swap(B, C);
+                    }
+                    Block.Triangles.Add(A);
+                    Block.Triangles.Add(B);
+                    Block.Triangles.Add(C);
+                }
+            }
+        }
+    }
+}
+
+void FFluidSurfaceMesher::AssembleMesh()
+{
+    TArray<const FBlock *> MeshedBlocks;
+    TArray<int32> VertexOffsets;
+    TArray<int32> TriangleOffsets;
+    MeshedBlocks.Reserve(Blocks.Num());
+    VertexOffsets.Reserve(Blocks.Num());
+    TriangleOffsets.Reserve(Blocks.Num());
+
+    int32 NumVertices = 0;
+    int32 NumIndices = 0;
+    for (const TPair<FIntVector, FBlock> &Entry : Blocks)
+    {
+        MeshedBlocks.Add(&Entry.Value);
+        VertexOffsets.Add(NumVertices);
+        TriangleOffsets.Add(NumIndices);
+        NumVertices += Entry.Value.Vertices.Num();
+        NumIndices += Entry.Value.Triangles.Num();
+    }
+
+    // Keep the allocations from the previous frame; the mesh size barely changes between frames
+    Vertices.SetNumUninitialized(NumVertices, EAllowShrinking::No);
+    Normals.SetNumUninitialized(NumVertices, EAllowShrinking::No);
+    Triangles.SetNumUninitialized(NumIndices, EAllowShrinking::No);
+
+    ParallelFor(MeshedBlocks.Num(), [&](int32 Index)
+        {
+            const FBlock &Block = *MeshedBlocks[Index];
+            const int32 VertexOffset = VertexOffsets[Index];
+            FMemory::Memcpy(Vertices.GetData() + VertexOffset, Block.Vertices.GetData(), Block.Vertices.Num() * sizeof(FVector));
+            FMemory::Memcpy(Normals.GetData() + VertexOffset, Block.Normals.GetData(), Block.Normals.Num() * sizeof(FVector));
+
+            int32 *OutTriangles = Triangles.GetData() + TriangleOffsets[Index];
+            for (int32 TriangleIndex = 0; TriangleIndex < Block.Triangles.Num(); ++TriangleIndex)
+            {
+                OutTriangles[TriangleIndex] = Block.Triangles[TriangleIndex] + VertexOffset;
+            }
+        });
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Settings of FFluidSurfaceMesher; mirrors the "Surface" properties on ABoundingRectangularPrism
+struct FFluidSurfaceMesherParams
+{
+	float CellSize = 8.0f; // Spacing of the density grid the surface is extracted from
+	float KernelRadius = 25.0f; // Distance over which each particle's density is splatted
+	float IsoLevel = 0.3f; // Surface density; a lone particle contributes 1 at its center, falling to 0 at KernelRadius
+	float RemeshTolerance = 2.0f; // Blocks are only re-meshed once one of their particles moved further than this
+	int32 BlockSize = 16; // Cells per block along each axis
+
+	bool operator==(const FFluidSurfaceMesherParams &Other) const = default;
+};
+
+// What the last Update did
+struct FFluidSurfaceMesherStats
+{
+	int32 NumBlocks = 0; // Blocks near at least one particle
+	int32 NumDirtyBlocks = 0; // Blocks re-meshed by the last Update
+	int32 NumVertices = 0;
+	int32 NumTriangles = 0;
+	float Ms = 0.0f;
+};
+
+// Headless fluid surface reconstruction: particle density is splatted onto a world-aligned grid, only around
+// occupied cells, and the IsoLevel surface is extracted with marching cubes.
+//
+// The grid is split into sparse blocks of BlockSize^3 cells. Each Update re-meshes only the blocks whose particles
+// moved by more than RemeshTolerance, in parallel, and every block keeps its density, vertex and index buffers between
+// updates so steady-state frames do not allocate. The blocks are then concatenated into one vertex/index buffer that
+// maps directly onto a single procedural mesh section.
+class FFluidSurfaceMesher
+{
+public:
+	FFluidSurfaceMesherParams Params;
+
+	// Re-mesh the blocks affected by particle movement; returns false if the combined mesh did not change
+	bool Update(TArrayView<const FVector> Positions);
+
+	void Reset(); // Drop all blocks and the combined mesh so the next Update rebuilds everything
+
+	/* Combined world-space mesh of every block; triangles are wound so their front faces point out of the fluid */
+	const TArray<FVector> &GetVertices() const { return Vertices; }
+
+	const TArray<FVector> &GetNormals() const { return Normals; }
+
+	const TArray<int32> &GetTriangles() const { return Triangles; }
+
+	const FFluidSurfaceMesherStats &GetStats() const { return Stats; }
+
+private:
+	struct FBlock
+	{
+		TArray<int32> ParticleIndices; // Particles within KernelRadius of any grid node the block reads
+		uint64 Signature = 0; // Order independent hash of the particles and their quantized positions when last meshed
+		uint64 NextSignature = 0; // Same, accumulated during the current Update
+		bool bTouched = false; // Has particles this Update
+		bool bMeshed = false;
+
+		TArray<float> Densities; // Grid nodes of the block plus a one node border for gradients
+		TArray<int32> EdgeVertices; // Vertex created on each grid edge, per node and axis; scratch
+		TArray<FVector> Vertices;
+		TArray<FVector> Normals;
+		TArray<int32> Triangles; // Indices into this block's Vertices
+	};
+
+	TMap<FIntVector, FBlock> Blocks;
+	FFluidSurfaceMesherParams MeshedParams; // Params the existing blocks were meshed with
+
+	TArray<FVector> Vertices;
+	TArray<FVector> Normals;
+	TArray<int32> Triangles;
+
+	FFluidSurfaceMesherStats Stats;
+
+	void MeshBlock(const FIntVector &BlockCoord, FBlock &Block, TArrayView<const FVector> Positions) const; // Splat density and run marching cubes over one block
+
+	void AssembleMesh(); // Concatenate every block's buffers into the combined mesh
+};
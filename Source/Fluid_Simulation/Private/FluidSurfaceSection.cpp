@@ -0,0 +1,35 @@
+#include "FluidSurfaceSection.h"
+
+#include "ProceduralMeshComponent.h"
+
+void FFluidSurfaceSection::Upload(UProceduralMeshComponent &Component, int32 SectionIndex, const FFluidSurfaceMesher &Mesher)
+{
+    const TArray<FVector> &Vertices = Mesher.GetVertices();
+    const TArray<FVector> &Normals = Mesher.GetNormals();
+    const TArray<int32> &Triangles = Mesher.GetTriangles();
+
+    // Marching cubes topology only survives small movements, but those are the common case for a settling fluid
+    Stats.bRecreated = Component.GetNumSections() <= SectionIndex || Vertices.Num() != NumUploadedVertices || Triangles != UploadedTriangles;
+
+    // The GPU vertex format stores float positions and normals whatever the precision of the mesher's vectors
+    Stats.Bytes = (int64)Vertices.Num() * 2 * sizeof(FVector3f) + (Stats.bRecreated ? (int64)Triangles.Num() * sizeof(uint32) : 0);
+
+    double StartTime = FPlatformTime::Seconds();
+    if (Stats.bRecreated)
+    {
+        Component.CreateMeshSection(SectionIndex, Vertices, Triangles, Normals, TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>(), false);
+        UploadedTriangles = Triangles;
+        NumUploadedVertices = Vertices.Num();
+    }
+    else
+    {
+        Component.UpdateMeshSection(SectionIndex, Vertices, Normals, TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>());
+    }
+    Stats.Ms = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FFluidSurfaceSection::Reset()
+{
+    UploadedTriangles.Reset();
+    NumUploadedVertices = 0;
+}
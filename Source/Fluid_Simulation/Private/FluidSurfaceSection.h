@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FluidSurfaceMesher.h"
+
+class UProceduralMeshComponent;
+
+// What the last Upload sent to the mesh section
+struct FFluidSurfaceSectionStats
+{
+	bool bRecreated = false; // Section rebuilt with new index data rather than vertex data rewritten in place
+	int64 Bytes = 0; // Positions, normals and, when recreated, indices; the payload the render thread copies to the GPU
+	float Ms = 0.0f; // Game thread time of the CreateMeshSection or UpdateMeshSection call
+};
+
+// Keeps one procedural mesh section in sync with the indexed mesh of an FFluidSurfaceMesher, so vertices shared by
+// neighbouring triangles are uploaded once. UpdateMeshSection can only rewrite vertex data of an unchanged topology,
+// so the section is updated in place while the mesher's index buffer is identical to the uploaded one and recreated
+// otherwise. The section always has exactly the mesher's vertex and index counts, so it never outgrows the surface.
+class FFluidSurfaceSection
+{
+public:
+	void Upload(UProceduralMeshComponent &Component, int32 SectionIndex, const FFluidSurfaceMesher &Mesher);
+
+	void Reset(); // Forget the uploaded topology so the next Upload recreates the section
+
+	const FFluidSurfaceSectionStats &GetStats() const { return Stats; }
+
+private:
+	TArray<int32> UploadedTriangles; // Index buffer the section was last created with
+	int32 NumUploadedVertices = 0;
+	FFluidSurfaceSectionStats Stats;
+};